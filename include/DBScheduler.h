@@ -0,0 +1,309 @@
+#ifndef DBScheduler_H
+#define DBScheduler_H
+
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include <ThreadPool.h>
+
+
+enum class DBLane { Read = 0, Write = 1 };
+
+struct DBLaneStats {
+    size_t   queued;            // callers waiting for a slot right now
+    size_t   in_flight;         // DB calls currently running
+    uint64_t completed;
+    uint64_t wait_us_total;     // time spent queued, summed over completed calls
+    uint64_t wait_us_max;
+    uint64_t shed;              // calls rejected: queued past their deadline, or too many waiting
+    bool     overloaded;        // queueing delay stayed above target for a whole interval
+};
+
+struct DBSchedulerOptions {
+    size_t   read_reserved = 2 ;    // slots only reads may use
+    size_t   write_reserved = 1 ;   // slots only writes may use
+    uint32_t read_weight = 3 ;      // share of the contended slots given to reads ...
+    uint32_t write_weight = 1 ;     // ... and to writes
+    uint32_t queue_target_ms = 20 ;     // acceptable standing queueing delay (CoDel target)
+    uint32_t queue_interval_ms = 100 ;  // window over which the minimum delay is tracked
+    uint32_t queue_deadline_ms = 1000 ; // longest a call may queue while the lane is healthy
+    size_t   max_waiting = 0 ;          // callers that may wait for a slot at once (both lanes), 0 = no limit
+};
+
+
+// When the HTTP task queue accepted the request the calling worker is
+// serving. The server's task queue sets it before running a connection and
+// clears it after each response (later requests on a keep-alive connection
+// never sat in the task queue). DBScheduler::Run() counts queueing delay
+// from here, so CoDel sees the whole wait and not only the one for a slot.
+class RequestQueueTime {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static void Set(Clock::time_point queued)   { slot() = queued ; }
+    static void Clear()                         { slot() = Clock::time_point() ; }
+
+    // The recorded time, or `now` when none is set
+    static Clock::time_point Get(Clock::time_point now) {
+        Clock::time_point queued = slot();
+        return queued == Clock::time_point() ? now : std::min(queued, now);
+    }
+
+private:
+    static Clock::time_point &slot() {
+        thread_local Clock::time_point queued;
+        return queued;
+    }
+};
+
+
+// Thrown by DBScheduler::Run() when a call is shed instead of being run
+class DBOverloaded : public std::runtime_error {
+public:
+    explicit DBOverloaded(uint32_t retry_after_sec)
+        : std::runtime_error("DB queue overloaded"), _retry_after_sec(retry_after_sec) {}
+    uint32_t RetryAfterSec() const { return _retry_after_sec; }
+private:
+    uint32_t _retry_after_sec;
+};
+
+
+// Admission control in front of the DB worker pool. Every DB call holds one
+// of `slots` (one per pooled connection) while it runs. Reads and writes wait
+// in separate FIFO lanes; each lane has a number of reserved slots the other
+// lane can never take, so a burst of slow upserts cannot occupy every
+// connection. When a slot frees up and both lanes are waiting, the next lane
+// is chosen by smooth weighted round-robin over the configured weights.
+//
+// Admitted calls run on the ThreadPool, which never queues because at most
+// `slots` calls are admitted at once.
+//
+// Queueing delay is bounded CoDel-style, per lane. A call's delay runs from
+// the time its request entered the HTTP task queue (RequestQueueTime) until
+// it gets a slot. If even the shortest delay seen during an interval exceeded
+// the target, the lane has a standing queue and is marked overloaded. Calls
+// that queue in an overloaded lane get only `target` to be admitted, healthy
+// lanes allow up to `deadline`; a call that runs out of time is removed from
+// the queue and Run() throws DBOverloaded. A call whose time already ran out
+// in the task queue, or that would make more than `max_waiting` callers
+// wait, is shed without waiting at all: every waiter blocks an HTTP worker
+// that cache hits need. Calls that get a slot without waiting are never shed.
+class DBScheduler {
+public:
+    DBScheduler(ThreadPool &pool, size_t slots, const DBSchedulerOptions &options = DBSchedulerOptions())
+        : _pool(pool), _slots(std::max<size_t>(1, slots))
+    {
+        // Reservations may not add up to more than the slots there are
+        _reserved[READ] = std::min(options.read_reserved, _slots);
+        _reserved[WRITE] = std::min(options.write_reserved, _slots - _reserved[READ]);
+        _weight[READ] = std::max<uint32_t>(1, options.read_weight);
+        _weight[WRITE] = std::max<uint32_t>(1, options.write_weight);
+        _target = std::chrono::milliseconds(options.queue_target_ms);
+        _interval = std::chrono::milliseconds(std::max<uint32_t>(1, options.queue_interval_ms));
+        _deadline = std::chrono::milliseconds(std::max(options.queue_deadline_ms, options.queue_target_ms));
+        _max_waiting = options.max_waiting;
+    }
+
+    DBScheduler(const DBScheduler&) = delete;
+    DBScheduler& operator=(const DBScheduler&) = delete;
+
+    // Wait for a slot in `lane`, run `f` on the pool and return its result
+    template <typename F>
+    auto Run(DBLane lane, F&& f) -> decltype(f()) {
+        Admission admission(*this, static_cast<int>(lane));
+        return _pool.run(std::forward<F>(f));
+    }
+
+    DBLaneStats Stats(DBLane lane) const {
+        int l = static_cast<int>(lane);
+        std::lock_guard<std::mutex> lock(_mutex);
+        return DBLaneStats{_queued[l], _in_flight[l], _completed[l], _wait_us_total[l], _wait_us_max[l],
+                           _shed[l], _codel[l].overloaded};
+    }
+
+    size_t Slots() const                    { return _slots ; }
+    size_t Reserved(DBLane lane) const      { return _reserved[static_cast<int>(lane)] ; }
+
+private:
+    static constexpr int READ = 0;
+    static constexpr int WRITE = 1;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Stack-allocated queue node of a caller waiting for a slot
+    struct Waiter {
+        std::atomic<uint32_t> granted{0};
+        Waiter *next = nullptr;
+        Clock::time_point enqueued;
+    };
+
+    // Minimum queueing delay seen in the current interval
+    struct CoDelState {
+        Clock::time_point interval_end;
+        Clock::duration min_delay = Clock::duration::max();
+        bool overloaded = false;
+    };
+
+    // Holds a slot for the lifetime of one Run() call
+    class Admission {
+    public:
+        Admission(DBScheduler &scheduler, int lane) : _scheduler(scheduler), _lane(lane) {
+            _start = Clock::now();
+            _scheduler.acquire(_lane, RequestQueueTime::Get(_start));
+            auto waited = Clock::now() - _start;
+            _wait_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(waited).count());
+        }
+        ~Admission() { _scheduler.release(_lane, _wait_us); }
+
+    private:
+        DBScheduler &_scheduler;
+        int _lane;
+        Clock::time_point _start;
+        uint64_t _wait_us = 0;
+    };
+
+    // Can `lane` take a slot without eating into the other lane's reservation?
+    bool can_admit(int lane) const {
+        size_t used = _in_flight[READ] + _in_flight[WRITE];
+        if (used >= _slots) return false;
+        int other = 1 - lane;
+        size_t held_for_other = _reserved[other] > _in_flight[other] ? _reserved[other] - _in_flight[other] : 0;
+        return _slots - used > held_for_other;
+    }
+
+    // `arrived`: when the request entered the HTTP task queue
+    void acquire(int lane, Clock::time_point arrived) {
+        Waiter self;
+        Clock::time_point deadline;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            Clock::time_point now = Clock::now();
+            self.enqueued = std::min(arrived, now);
+            // Callers already queued in this lane go first
+            if (_head[lane] == nullptr && can_admit(lane)) {
+                ++_in_flight[lane];
+                observe_delay(lane, now - self.enqueued, now);
+                return;
+            }
+            deadline = self.enqueued + (_codel[lane].overloaded ? _target : _deadline);
+            if (deadline <= now || (_max_waiting > 0 && _queued[READ] + _queued[WRITE] >= _max_waiting)) {
+                ++_shed[lane];
+                throw DBOverloaded(retry_after_sec());
+            }
+            if (_tail[lane]) _tail[lane]->next = &self;
+            else _head[lane] = &self;
+            _tail[lane] = &self;
+            ++_queued[lane];
+        }
+
+        while (self.granted.load(std::memory_order_acquire) == 0) {
+            auto left = deadline - Clock::now();
+            if (left <= Clock::duration::zero()) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (self.granted.load(std::memory_order_acquire)) break;   // granted just in time
+                unlink(lane, &self);
+                --_queued[lane];
+                ++_shed[lane];
+                throw DBOverloaded(retry_after_sec());
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+            struct timespec timeout = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+            futex_wait(&self.granted, 0, &timeout);
+        }
+    }
+
+    void unlink(int lane, Waiter *waiter) {
+        Waiter *prev = nullptr;
+        for (Waiter *w = _head[lane]; w; prev = w, w = w->next) {
+            if (w != waiter) continue;
+            if (prev) prev->next = w->next;
+            else _head[lane] = w->next;
+            if (_tail[lane] == w) _tail[lane] = prev;
+            return;
+        }
+    }
+
+    // Feed one queueing delay into the lane's CoDel window, with _mutex held
+    void observe_delay(int lane, Clock::duration delay, Clock::time_point now) {
+        CoDelState &codel = _codel[lane];
+        codel.min_delay = std::min(codel.min_delay, delay);
+        if (now < codel.interval_end) return;
+        codel.overloaded = codel.min_delay > _target;
+        codel.min_delay = Clock::duration::max();
+        codel.interval_end = now + _interval;
+    }
+
+    // Clients should come back once the standing queue had a chance to drain
+    uint32_t retry_after_sec() const {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(_interval + _target).count();
+        return static_cast<uint32_t>(std::max<long long>(1, (ms + 999) / 1000));
+    }
+
+    void release(int lane, uint64_t wait_us) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_in_flight[lane];
+        ++_completed[lane];
+        _wait_us_total[lane] += wait_us;
+        _wait_us_max[lane] = std::max(_wait_us_max[lane], wait_us);
+        dispatch();
+    }
+
+    // Hand free slots to queued callers, called with _mutex held
+    void dispatch() {
+        for (;;) {
+            bool eligible[2];
+            for (int l = READ; l <= WRITE; ++l) eligible[l] = _head[l] != nullptr && can_admit(l);
+            if (!eligible[READ] && !eligible[WRITE]) return;
+
+            int lane = eligible[READ] ? READ : WRITE;
+            if (eligible[READ] && eligible[WRITE]) {
+                // Smooth weighted round-robin: every contender earns its weight,
+                // the richest wins and pays back the total
+                _credit[READ] += _weight[READ];
+                _credit[WRITE] += _weight[WRITE];
+                lane = _credit[READ] >= _credit[WRITE] ? READ : WRITE;
+                _credit[lane] -= static_cast<int64_t>(_weight[READ] + _weight[WRITE]);
+            }
+
+            Waiter *waiter = _head[lane];
+            _head[lane] = waiter->next;
+            if (_head[lane] == nullptr) _tail[lane] = nullptr;
+            --_queued[lane];
+            ++_in_flight[lane];
+            Clock::time_point now = Clock::now();
+            observe_delay(lane, now - waiter->enqueued, now);
+            // The waiter may return (and its node go away) as soon as it sees
+            // the flag; a wake on the stale address is harmless.
+            waiter->granted.store(1, std::memory_order_release);
+            futex_wake(&waiter->granted, 1);
+        }
+    }
+
+    ThreadPool &_pool;
+    const size_t _slots;
+    size_t _reserved[2];
+    uint32_t _weight[2];
+    Clock::duration _target;
+    Clock::duration _interval;
+    Clock::duration _deadline;
+    size_t _max_waiting;
+
+    mutable std::mutex _mutex;
+    Waiter *_head[2] = {nullptr, nullptr};
+    Waiter *_tail[2] = {nullptr, nullptr};
+    int64_t _credit[2] = {0, 0};
+    size_t _queued[2] = {0, 0};
+    size_t _in_flight[2] = {0, 0};
+    uint64_t _completed[2] = {0, 0};
+    uint64_t _wait_us_total[2] = {0, 0};
+    uint64_t _wait_us_max[2] = {0, 0};
+    uint64_t _shed[2] = {0, 0};
+    CoDelState _codel[2];
+};
+
+#endif
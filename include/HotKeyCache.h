@@ -0,0 +1,255 @@
+#ifndef HotKeyCache_H
+#define HotKeyCache_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <sched.h>
+
+#include <LRUCache.h>
+#include <Numa.h>
+
+
+// Space-saving top-K sketch (Metwally et al.): keeps at most `capacity`
+// counters. An unseen key takes over the smallest counter and inherits its
+// count as the error bound, so every key whose true frequency exceeds
+// N / capacity is guaranteed to be tracked.
+class SpaceSaving {
+public:
+    struct Counter {
+        long long key;
+        uint64_t  count;
+        uint64_t  error;        // over-estimation bound inherited on takeover
+    };
+
+    explicit SpaceSaving(size_t capacity) : _capacity(std::max<size_t>(1, capacity)) {}
+
+    void Offer(long long key) {
+        ++_total;
+        auto it = _index.find(key);
+        if (it != _index.end()) {
+            ++_counters[it->second].count;
+            return;
+        }
+        if (_counters.size() < _capacity) {
+            _index[key] = _counters.size();
+            _counters.push_back(Counter{key, 1, 0});
+            return;
+        }
+        // Evict the minimum. Only unseen keys pay for this scan.
+        size_t min_pos = 0;
+        for (size_t i = 1; i < _counters.size(); ++i)
+            if (_counters[i].count < _counters[min_pos].count) min_pos = i;
+        Counter &victim = _counters[min_pos];
+        _index.erase(victim.key);
+        _index[key] = min_pos;
+        victim = Counter{key, victim.count + 1, victim.count};
+    }
+
+    const std::vector<Counter> &Counters() const { return _counters; }
+
+    // Halve every count so that keys which cooled down can be displaced
+    void Decay() {
+        _total /= 2;
+        for (auto &c : _counters) {
+            c.count /= 2;
+            c.error /= 2;
+        }
+    }
+
+private:
+    size_t _capacity;
+    uint64_t _total = 0;
+    std::vector<Counter> _counters;
+    std::unordered_map<long long, size_t> _index;
+};
+
+
+// Read-mostly copy of the hottest cache entries, replicated once per CPU so
+// that lookups of a skewed key set stop serialising on the few shard locks
+// those keys hash to. Each replica has its own lock and table on its own
+// cache lines; a reader only ever touches the replica of the CPU it runs on.
+//
+// Hotness is sampled into one SpaceSaving sketch per CPU, so counting a read
+// only locks its own CPU's sketch. Refresh() (called from the server's
+// maintenance thread) merges the sketches and republishes the current top
+// keys, and every PUT/DELETE calls Invalidate() after updating the main cache.
+//
+// With `numa_aware`, the replica of CPU c keeps its table and values in an
+// arena on c's NUMA node, so hot reads never leave the local node.
+class HotKeyCache {
+public:
+    HotKeyCache(size_t hot_keys, uint32_t sample_every, bool numa_aware = false,
+                size_t replicas = std::thread::hardware_concurrency())
+        : _hot_keys(hot_keys),
+          _sample_every(std::max<uint32_t>(1, sample_every)),
+          _replicas(std::max<size_t>(1, replicas))
+    {
+        const NumaTopology &topology = NumaTopology::Get();
+        for (size_t cpu = 0; cpu < _replicas.size(); ++cpu) {
+            Replica &replica = _replicas[cpu];
+            replica.arena = std::make_unique<NumaArena>(numa_aware ? topology.NodeOfCpu(static_cast<int>(cpu)) : -1);
+            replica.table = make_table(*replica.arena);
+            _sketches.push_back(std::make_unique<LocalSketch>(2 * std::max<size_t>(1, hot_keys)));
+        }
+    }
+
+    bool Enabled() const { return _hot_keys > 0; }
+
+    // Sampled access counting for the hot-key sketch
+    void Record(long long key) {
+        if (!Enabled()) return;
+        thread_local uint32_t calls = 0;
+        if (++calls % _sample_every != 0) return;
+        LocalSketch &local = *_sketches[local_cpu()];
+        std::lock_guard<std::mutex> lock(local.mutex);
+        local.sketch.Offer(key);
+    }
+
+    // Lookup in the calling CPU's replica
+    bool Get(long long key, std::string &value) {
+        if (_published == 0) return false;
+        Replica &replica = local_replica();
+        std::shared_lock<std::shared_mutex> lock(replica.mutex);
+        auto it = replica.table->find(key);
+        if (it == replica.table->end()) return false;
+        if (it->second.expire_at != 0 && it->second.expire_at <= CacheClock::Now()) return false;
+        value.assign(it->second.value.data(), it->second.value.size());
+        return true;
+    }
+
+    // Drop `key` from every replica. Must be called after the main cache has
+    // been updated, so that a concurrent Refresh() cannot republish the old value.
+    // While nothing is published this returns without locking; a Refresh()
+    // running at that moment catches the change when it re-checks its values.
+    void Invalidate(long long key) {
+        if (_published == 0) return;
+        std::lock_guard<std::mutex> lock(_publish_mutex);
+        unpublish(key);
+    }
+
+    // Republish the current top keys with values read from `cache`
+    void Refresh(ShardedLRUCache &cache) {
+        if (!Enabled()) return;
+        // Sketches of disjoint sample streams merge by adding counters. The
+        // guaranteed counts (count - error) are summed, so a key's total
+        // stays a lower bound on its samples across all CPUs.
+        std::unordered_map<long long, uint64_t> merged;
+        for (auto &local : _sketches) {
+            std::lock_guard<std::mutex> lock(local->mutex);
+            for (auto &c : local->sketch.Counters()) merged[c.key] += c.count - c.error;
+            local->sketch.Decay();
+        }
+
+        // A key needs a few samples before it is worth replicating
+        std::vector<std::pair<uint64_t, long long>> ranked;     // (count, key)
+        for (auto &m : merged)
+            if (m.second >= 4) ranked.emplace_back(m.second, m.first);
+        size_t n = std::min(_hot_keys, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+                          std::greater<std::pair<uint64_t, long long>>());
+        std::vector<long long> top;
+        for (size_t i = 0; i < n; ++i) top.push_back(ranked[i].second);
+
+        // Replica arenas are only touched with _publish_mutex held
+        std::lock_guard<std::mutex> lock(_publish_mutex);
+        struct Fresh { long long key; SharedValue value; uint32_t expire_at; };
+        std::vector<Fresh> fresh;
+        SharedValue value;
+        uint32_t expire_at = 0;
+        for (long long key : top) {
+            // Only live values are replicated, never misses or tombstones
+            if (cache.Lookup(key, value, &expire_at) == CacheLookup::Hit)
+                fresh.push_back(Fresh{key, value, expire_at});
+        }
+
+        for (auto &replica : _replicas) {
+            auto table = make_table(*replica.arena);
+            for (auto &f : fresh)
+                table->emplace(f.key, Entry{ArenaString(f.value.data(), f.value.size(), CharAllocator(replica.arena.get())), f.expire_at});
+            std::unique_lock<std::shared_mutex> replica_lock(replica.mutex);
+            replica.table.swap(table);
+        }
+        _published_keys.clear();
+        for (auto &f : fresh) _published_keys.insert(f.key);
+        _published = _published_keys.size();
+
+        // An Invalidate() that ran while nothing was published returned
+        // without the lock, so its PUT/DELETE may have replaced a value read
+        // above. Such a cache write comes before this re-check (both take the
+        // shard lock); a later one sees _published set and waits for the lock.
+        SharedValue current;
+        for (auto &f : fresh) {
+            if (cache.Peek(f.key, &current) != CacheLookup::Hit || !current.SharesBuffer(f.value))
+                unpublish(f.key);
+        }
+    }
+
+    size_t Published() const { return _published; }
+
+private:
+    using CharAllocator = NumaAllocator<char>;
+    using ArenaString = std::basic_string<char, std::char_traits<char>, CharAllocator>;
+
+    struct Entry {
+        ArenaString value;
+        uint32_t    expire_at;
+    };
+    using Table = std::unordered_map<long long, Entry, std::hash<long long>, std::equal_to<long long>,
+                                     NumaAllocator<std::pair<const long long, Entry>>>;
+
+    struct alignas(64) Replica {
+        std::shared_mutex mutex;
+        std::unique_ptr<NumaArena> arena;   // declared before table: outlives it
+        std::unique_ptr<Table> table;
+    };
+
+    static std::unique_ptr<Table> make_table(NumaArena &arena) {
+        return std::make_unique<Table>(0, std::hash<long long>(), std::equal_to<long long>(),
+                                       NumaAllocator<std::pair<const long long, Entry>>(&arena));
+    }
+
+    // Remove `key` from every replica, with _publish_mutex held
+    void unpublish(long long key) {
+        if (_published_keys.erase(key) == 0) return;
+        for (auto &replica : _replicas) {
+            std::unique_lock<std::shared_mutex> replica_lock(replica.mutex);
+            replica.table->erase(key);
+        }
+        _published = _published_keys.size();
+    }
+
+    // Sampled reads of one CPU; only Refresh() ever locks it from elsewhere
+    struct alignas(64) LocalSketch {
+        explicit LocalSketch(size_t capacity) : sketch(capacity) {}
+        std::mutex mutex;
+        SpaceSaving sketch;
+    };
+
+    // Index of the calling CPU's replica and sketch
+    size_t local_cpu() const {
+        int cpu = sched_getcpu();
+        return (cpu < 0 ? 0 : static_cast<size_t>(cpu)) % _replicas.size();
+    }
+
+    Replica &local_replica() { return _replicas[local_cpu()]; }
+
+    size_t _hot_keys;
+    uint32_t _sample_every;
+
+    std::vector<Replica> _replicas;
+    std::vector<std::unique_ptr<LocalSketch>> _sketches;    // one per replica
+    std::mutex _publish_mutex;
+    std::unordered_set<long long> _published_keys;
+    std::atomic<size_t> _published{0};
+};
+
+#endif
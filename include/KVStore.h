@@ -0,0 +1,153 @@
+#ifndef KVStore_H
+#define KVStore_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+
+// The backing store behind the cache. Every call is one blocking query and
+// is made from a DB pool worker, so implementations must be thread-safe.
+class KVStore {
+public:
+    virtual ~KVStore() = default;
+
+    // The value of `key`, or nullopt when it is missing. `failed` (optional)
+    // tells a query error apart from a missing key.
+    virtual std::optional<std::string> Select(long long key, bool *failed = nullptr) = 0;
+    // Inserts or replaces the value of `key`
+    virtual bool Upsert(long long key, const std::string &value) = 0;
+    // {query succeeded, rows deleted}
+    virtual std::pair<bool, uint64_t> Delete(long long key) = 0;
+    // Up to `limit` rows, most recently written first, skipping `offset` (cache warm-up)
+    virtual bool SelectRecent(size_t limit, size_t offset, std::vector<std::pair<long long, std::string>> &rows) = 0;
+    // Up to `limit` rows with keys >= `start_key`, in key order (scans)
+    virtual bool SelectRange(long long start_key, size_t limit, std::vector<std::pair<long long, std::string>> &rows) = 0;
+
+    virtual std::string Describe() const = 0;
+};
+
+
+struct MockStoreOptions {
+    uint32_t latency_us = 0 ;       // Added to every query, 0 = answer at memory speed
+    size_t   slots = 8 ;            // Queries served at once; further queries wait for a slot
+    size_t   keys = 0 ;             // Keys 1..keys present at startup
+    size_t   value_size = 32 ;      // Bytes per preloaded value
+};
+
+// In-memory store that stands in for MySQL, so the HTTP, cache and
+// threading layers can be benchmarked without a database. A query holds one
+// of `slots` slots for `latency_us`, which models a database that serves at
+// most slots / latency queries per second, with the same delay every time.
+class MockKVStore : public KVStore {
+public:
+    explicit MockKVStore(const MockStoreOptions &options)
+        : _options(options), _free_slots(std::max<size_t>(1, options.slots))
+    {
+        _options.slots = _free_slots;
+        const std::string value(_options.value_size, 'v');
+        for (size_t key = 1; key <= _options.keys; ++key)
+            _rows.emplace(static_cast<long long>(key), Row{value, ++_next_seq});
+    }
+
+    std::optional<std::string> Select(long long key, bool *failed = nullptr) override {
+        Slot slot(*this);
+        if (failed) *failed = false;
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto it = _rows.find(key);
+        if (it == _rows.end()) return std::nullopt;
+        return it->second.value;
+    }
+
+    bool Upsert(long long key, const std::string &value) override {
+        Slot slot(*this);
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        Row &row = _rows[key];
+        row.value = value;
+        row.seq = ++_next_seq;
+        return true;
+    }
+
+    std::pair<bool, uint64_t> Delete(long long key) override {
+        Slot slot(*this);
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        return {true, static_cast<uint64_t>(_rows.erase(key))};
+    }
+
+    bool SelectRecent(size_t limit, size_t offset, std::vector<std::pair<long long, std::string>> &rows) override {
+        Slot slot(*this);
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        std::vector<std::pair<uint64_t, long long>> order;      // (seq, key)
+        order.reserve(_rows.size());
+        for (auto &row : _rows) order.emplace_back(row.second.seq, row.first);
+        std::sort(order.begin(), order.end(), std::greater<std::pair<uint64_t, long long>>());
+        for (size_t i = offset; i < order.size() && i < offset + limit; ++i)
+            rows.emplace_back(order[i].second, _rows.at(order[i].second).value);
+        return true;
+    }
+
+    bool SelectRange(long long start_key, size_t limit, std::vector<std::pair<long long, std::string>> &rows) override {
+        Slot slot(*this);
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        for (auto it = _rows.lower_bound(start_key); it != _rows.end() && rows.size() < limit; ++it)
+            rows.emplace_back(it->first, it->second.value);
+        return true;
+    }
+
+    std::string Describe() const override {
+        return "mock store (" + std::to_string(_options.keys) + " keys, " + std::to_string(_options.latency_us) +
+               " us per query, " + std::to_string(_options.slots) + " slots)";
+    }
+
+private:
+    struct Row {
+        std::string value;
+        uint64_t seq;       // write order, for SelectRecent
+    };
+
+    // Holds a query slot, and the injected latency, for the lifetime of a query
+    class Slot {
+    public:
+        explicit Slot(MockKVStore &store) : _store(store) {
+            {
+                std::unique_lock<std::mutex> lock(_store._slot_mutex);
+                _store._slot_cv.wait(lock, [this] { return _store._free_slots > 0; });
+                --_store._free_slots;
+            }
+            if (_store._options.latency_us)
+                std::this_thread::sleep_for(std::chrono::microseconds(_store._options.latency_us));
+        }
+        ~Slot() {
+            {
+                std::lock_guard<std::mutex> lock(_store._slot_mutex);
+                ++_store._free_slots;
+            }
+            _store._slot_cv.notify_one();
+        }
+
+    private:
+        MockKVStore &_store;
+    };
+
+    MockStoreOptions _options;
+
+    std::mutex _slot_mutex;
+    std::condition_variable _slot_cv;
+    size_t _free_slots;
+
+    std::shared_mutex _mutex;
+    std::map<long long, Row> _rows;     // ordered, for SelectRange
+    uint64_t _next_seq = 0;
+};
+
+#endif
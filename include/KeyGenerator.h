@@ -0,0 +1,224 @@
+#ifndef KeyGenerator_H
+#define KeyGenerator_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+// Key popularity models for the load generator. Keys are integers in
+// [1, keys]; the skewed ones follow the YCSB core generators so that hit
+// ratios are comparable with published YCSB numbers.
+enum class KeyDistribution {
+    Sequential,         // every key in turn (each thread walks its own stride)
+    Uniform,            // every key equally likely
+    Zipfian,            // key k has popularity ~ 1/k^theta: low keys are hot
+    ScrambledZipfian,   // Zipfian popularity, hot keys spread over the key space
+    Hotspot,            // hot_ops of the requests go to the first hot_fraction of the keys
+    Latest              // Zipfian over age: the most recently inserted keys are hot
+};
+
+struct KeyDistributionOptions {
+    KeyDistribution kind = KeyDistribution::Sequential ;
+    long long keys = 10000 ;        // key space size
+    double theta = 0.99 ;           // Zipfian skew (YCSB default), 0 < theta < 1
+    double hot_fraction = 0.2 ;     // hotspot: share of the key space that is hot ...
+    double hot_ops = 0.8 ;          // ... and share of the requests it receives
+};
+
+inline KeyDistribution parse_key_distribution(const std::string &name)
+{
+    if (name == "sequential") return KeyDistribution::Sequential;
+    if (name == "uniform") return KeyDistribution::Uniform;
+    if (name == "zipfian") return KeyDistribution::Zipfian;
+    if (name == "scrambled_zipfian") return KeyDistribution::ScrambledZipfian;
+    if (name == "hotspot") return KeyDistribution::Hotspot;
+    if (name == "latest") return KeyDistribution::Latest;
+    throw std::invalid_argument("Invalid key distribution: " + name +
+                                " (expected sequential, uniform, zipfian, scrambled_zipfian, hotspot or latest)");
+}
+
+inline const char *key_distribution_name(KeyDistribution kind)
+{
+    switch (kind) {
+        case KeyDistribution::Sequential:       return "sequential";
+        case KeyDistribution::Uniform:          return "uniform";
+        case KeyDistribution::Zipfian:          return "zipfian";
+        case KeyDistribution::ScrambledZipfian: return "scrambled_zipfian";
+        case KeyDistribution::Hotspot:          return "hotspot";
+        case KeyDistribution::Latest:           return "latest";
+    }
+    return "unknown";
+}
+
+// 64-bit FNV-1a over the bytes of `value`, as used by YCSB to scramble keys
+inline uint64_t fnv1a64(uint64_t value)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; ++i) {
+        hash ^= value & 0xFF;
+        hash *= 1099511628211ULL;
+        value >>= 8;
+    }
+    return hash;
+}
+
+
+// Constants of a Zipfian distribution over `items` ranks (Gray et al.,
+// "Quickly Generating Billion-Record Synthetic Databases"). Computing zeta
+// takes one pow() per item, so it is done once and shared, read-only, by
+// every thread's KeyGenerator.
+class ZipfianParams {
+public:
+    ZipfianParams(long long items, double theta) : _items(items), _theta(theta) {
+        if (items < 1) throw std::invalid_argument("Zipfian: key space must not be empty");
+        if (!(theta > 0 && theta < 1)) throw std::invalid_argument("Zipfian: theta must be in (0, 1)");
+        _zeta2 = zeta(2, theta);
+        _zetan = zeta(items, theta);
+        _alpha = 1.0 / (1.0 - theta);
+        _eta = (1.0 - std::pow(2.0 / static_cast<double>(items), 1.0 - theta)) / (1.0 - _zeta2 / _zetan);
+        _half_pow_theta = 1.0 + std::pow(0.5, theta);
+    }
+
+    // Rank in [0, items) for a uniform `u` in [0, 1); rank 0 is the most popular
+    long long Rank(double u) const {
+        double uz = u * _zetan;
+        if (uz < 1.0) return 0;
+        if (uz < _half_pow_theta) return std::min<long long>(1, _items - 1);
+        long long rank = static_cast<long long>(static_cast<double>(_items) * std::pow(_eta * u - _eta + 1.0, _alpha));
+        return std::min(rank, _items - 1);
+    }
+
+    long long Items() const { return _items ; }
+    double Theta() const    { return _theta ; }
+
+private:
+    static double zeta(long long n, double theta) {
+        double sum = 0;
+        for (long long i = 1; i <= n; ++i) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        return sum;
+    }
+
+    long long _items;
+    double _theta;
+    double _zeta2;
+    double _zetan;
+    double _alpha;
+    double _eta;
+    double _half_pow_theta;
+};
+
+
+// Key counter for inserts that only exposes keys whose insert has finished
+// (YCSB's AcknowledgedCounterGenerator). Next() hands out a new key when an
+// insert is planned; Acknowledge() marks it stored once the server said so;
+// Last() is the highest key below which every insert was acknowledged, so
+// reads never pick a key that is still in flight. An insert that fails is
+// never acknowledged and holds Last() back: reads stay on keys that exist.
+class AcknowledgedCounter {
+public:
+    explicit AcknowledgedCounter(long long start)
+        : _issued(start), _last(start), _window(new std::atomic<long long>[WINDOW]) {
+        for (size_t i = 0; i < WINDOW; ++i) _window[i].store(0, std::memory_order_relaxed);
+    }
+
+    long long Next() { return _issued.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+    long long Last() const { return _last.load(std::memory_order_acquire); }
+
+    void Acknowledge(long long key) {
+        _window[static_cast<size_t>(key) & (WINDOW - 1)].store(key, std::memory_order_release);
+        // One thread at a time moves Last() over the acknowledged run; the
+        // others leave their keys for it (or for the next Acknowledge)
+        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+        long long last = _last.load(std::memory_order_relaxed);
+        while (_window[static_cast<size_t>(last + 1) & (WINDOW - 1)].load(std::memory_order_acquire) == last + 1) ++last;
+        _last.store(last, std::memory_order_release);
+    }
+
+private:
+    // Inserts that may finish out of order; slots hold the key last acknowledged there
+    static constexpr size_t WINDOW = size_t(1) << 20;
+
+    std::atomic<long long> _issued;
+    std::atomic<long long> _last;
+    std::unique_ptr<std::atomic<long long>[]> _window;
+    std::mutex _mutex;
+};
+
+
+// Per-thread key source. Nothing is shared between threads except the
+// read-only Zipfian constants and, for Latest, the insert counter that
+// tells where the newest acknowledged key is; in particular the sequential distribution
+// gives thread t of T the keys t+1, t+1+T, ... instead of bumping one
+// global counter on every request.
+class KeyGenerator {
+public:
+    // `zipfian` is required for the Zipfian, ScrambledZipfian and Latest
+    // kinds. `latest`, if given, counts the keys inserted so far
+    // (Latest falls back to the top of the key space).
+    KeyGenerator(const KeyDistributionOptions &options, const ZipfianParams *zipfian,
+                 int thread, int threads, uint64_t seed, const AcknowledgedCounter *latest = nullptr)
+        : _options(options), _zipfian(zipfian), _latest(latest), _rng(seed),
+          _next(thread), _stride(std::max(threads, 1))
+    {
+        if (_options.keys < 1) throw std::invalid_argument("Key space must not be empty");
+        bool needs_zipfian = options.kind == KeyDistribution::Zipfian ||
+                             options.kind == KeyDistribution::ScrambledZipfian ||
+                             options.kind == KeyDistribution::Latest;
+        if (needs_zipfian && (!zipfian || zipfian->Items() != options.keys))
+            throw std::invalid_argument("Zipfian constants missing or built for another key space");
+        _hot_keys = std::max<long long>(1, static_cast<long long>(_options.hot_fraction * static_cast<double>(_options.keys)));
+    }
+
+    // Next key, in [1, keys] (Latest: in [1, latest])
+    long long Next() {
+        const long long keys = _options.keys;
+        switch (_options.kind) {
+            case KeyDistribution::Sequential: {
+                long long key = _next % keys + 1;
+                _next += _stride;
+                return key;
+            }
+            case KeyDistribution::Uniform:
+                return uniform(1, keys);
+            case KeyDistribution::Zipfian:
+                return _zipfian->Rank(unit()) + 1;
+            case KeyDistribution::ScrambledZipfian:
+                return static_cast<long long>(fnv1a64(static_cast<uint64_t>(_zipfian->Rank(unit()))) % static_cast<uint64_t>(keys)) + 1;
+            case KeyDistribution::Hotspot:
+                if (_hot_keys >= keys || unit() < _options.hot_ops) return uniform(1, _hot_keys);
+                return uniform(_hot_keys + 1, keys);
+            case KeyDistribution::Latest: {
+                // Inserts may have grown the key space past `keys`
+                long long newest = std::max<long long>(_latest ? _latest->Last() : keys, 1);
+                // Ranks beyond the keys inserted so far wrap around to the oldest ones
+                return newest - _zipfian->Rank(unit()) % newest;
+            }
+        }
+        return 1;
+    }
+
+    const KeyDistributionOptions &Options() const { return _options ; }
+
+private:
+    double unit() { return std::uniform_real_distribution<double>(0.0, 1.0)(_rng); }
+    long long uniform(long long lo, long long hi) { return std::uniform_int_distribution<long long>(lo, hi)(_rng); }
+
+    KeyDistributionOptions _options;
+    const ZipfianParams *_zipfian;
+    const AcknowledgedCounter *_latest;
+    std::mt19937_64 _rng;
+    long long _next;
+    long long _stride;
+    long long _hot_keys;
+};
+
+#endif
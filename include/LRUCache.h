@@ -4,53 +4,198 @@
 #include <list>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include <Numa.h>
+#include <SharedValue.h>
+
+
+// Coarse (1 s) monotonic clock used for entry expiry. Ticks count seconds from
+// the first call, so an expiry time fits in 32 bits; tick 0 means "never".
+struct CacheClock {
+    static uint32_t Now() {
+        static const auto epoch = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::steady_clock::now() - epoch;
+        return 1 + static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(elapsed).count());
+    }
 
+    // Expiry tick for an entry living `ttl_sec` seconds from now (0 = no expiry)
+    static uint32_t ExpiryAfter(uint32_t ttl_sec) {
+        return ttl_sec == 0 ? 0 : Now() + ttl_sec;
+    }
+};
 
 template <typename Key, typename Value>
+struct LRUEntry {
+    Key      key;
+    Value    value;
+    uint32_t expire_at;     // CacheClock tick at which the entry goes stale, 0 = never
+    bool     absent;        // Tombstone: the key is known not to exist in the DB
+    // Neighbours in the timer-wheel slot of `expire_at` (entries with an expiry only)
+    LRUEntry *wheel_prev = nullptr;
+    LRUEntry *wheel_next = nullptr;
+};
+
+// Outcome of a cache lookup: a value, a remembered "not found", or nothing
+enum class CacheLookup { Miss, Hit, Absent };
+
+template <typename Key, typename Value, typename Alloc = std::allocator<LRUEntry<Key, Value>>>
 class LRUCache {
 public:
-    explicit LRUCache(size_t capacity) ;
+    explicit LRUCache(size_t capacity, const Alloc &alloc = Alloc()) ;
+
+    // Puts a key-value pair into the cache, expiring at CacheClock tick
+    // `expire_at` (0 = lives until evicted).
+    void Put(const Key& key, const Value& value, uint32_t expire_at = 0) ; 
+
+    // Like Put(), but leaves an unexpired entry for `key` (value or tombstone)
+    // alone. Returns false when the cache already had one.
+    bool PutIfAbsent(const Key& key, const Value& value, uint32_t expire_at = 0) ;
+
+    // Remembers that `key` does not exist until tick `expire_at`. A live
+    // value already cached for the key wins.
+    void PutAbsent(const Key& key, uint32_t expire_at) ;
 
-    // Puts a key-value pair into the cache.
-    void Put(const Key& key, const Value& value) ; 
+    // Turns the entry of `key` into a tombstone expiring at `expire_at`, but
+    // only if it is still in the state `seen` (with value `seen_value`) that
+    // an earlier Peek() returned. Otherwise the entry is erased.
+    void ReplaceWithAbsent(const Key& key, uint32_t expire_at, CacheLookup seen, const Value& seen_value) ;
 
-    // Gets a value by its key. Returns std::nullopt if not found.
+    // Gets a value by its key. Returns false on a miss or a tombstone.
     bool Get(const Key& key, Value &ret_val) ; 
 
+    // Like Get(), but tells a plain miss apart from a tombstone. On a hit the
+    // entry's expiry tick is stored in `expire_at` when given.
+    CacheLookup Lookup(const Key& key, Value &ret_val, uint32_t *expire_at = nullptr) ;
+
+    // Like Lookup(), but leaves the recency order and expired entries alone,
+    // so it is safe under a shared lock. The value is copied if `ret_val` is given.
+    CacheLookup Peek(const Key& key, Value *ret_val = nullptr) const ;
+
     // Deletes an item from the cache.
     void Erase(const Key& key) ; 
 
     // Return the contents of the cache in the form of key,value pair
     std::string GetContents() ;
 
+    // Visit every cached value (tombstones are skipped) from the least to the
+    // most recently used one, so that replaying the visits through Put()
+    // rebuilds the same recency order.
+    // `fn` is called as fn(key, value, expire_at).
+    template <typename Fn>
+    void ForEachFromLRU(Fn&& fn) ;
+
+    // Advance the expiry timer wheel up to tick `now`, erasing the entries
+    // that expired on the way. Returns the number of entries erased.
+    size_t ExpireTick(uint32_t now) ;
+
     size_t Capacity()                                   { return _capacity ; }
     size_t Size()                                       { return _item_map.size() ; }
+    uint64_t Evictions()                                { return _evictions ; }
 
 private:
+    // Hashed timer wheel with one-second slots. An entry is linked into the
+    // slot of its expiry tick (intrusively, so it sits in exactly one slot
+    // and a re-put moves it); a slot is swept when the wheel passes it, so
+    // the work per tick is proportional to what expires in it. Expiries
+    // further out than one revolution stay in their slot until their round.
+    static constexpr uint32_t WHEEL_SLOTS = 512;
+
+    using Entry     = LRUEntry<Key, Value>;
+    using EntryList = std::list<Entry, Alloc>;
+    using MapAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<
+                          std::pair<const Key, typename EntryList::iterator>>;
+    using ItemMap   = std::unordered_map<Key, typename EntryList::iterator, std::hash<Key>, std::equal_to<Key>, MapAlloc>;
+
+    void wheel_link(Entry &entry) ;
+    void wheel_unlink(Entry &entry) ;
+    void erase_entry(typename ItemMap::iterator it) ;
+    void store(const Key& key, const Value& value, uint32_t expire_at, bool absent) ;
+
     size_t _capacity;
-    std::list<std::pair<Key, Value>> _item_list;
-    std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator> _item_map;
+    EntryList _item_list;
+    ItemMap _item_map;
+    std::vector<Entry*> _wheel;             // slot heads, allocated on the first entry with a TTL
+    uint32_t _wheel_tick = 0;               // last tick swept
+    uint64_t _evictions = 0;                // entries pushed out by capacity
     // std::mutex _mutex;
 };
 
-template <typename Key, typename Value>
-LRUCache<Key, Value>::LRUCache (size_t capacity):
-         _capacity(capacity)
+template <typename Key, typename Value, typename Alloc>
+LRUCache<Key, Value, Alloc>::LRUCache (size_t capacity, const Alloc &alloc):
+         _capacity(capacity),
+         _item_list(alloc),
+         _item_map(0, std::hash<Key>(), std::equal_to<Key>(), MapAlloc(alloc))
+{
+    // Size the hash table once so it never rehashes while the shard is locked
+    _item_map.reserve(capacity);
+}
+
+
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::Put(const Key& key, const Value& value, uint32_t expire_at)
 {
+    store(key, value, expire_at, false);
+}
 
+template <typename Key, typename Value, typename Alloc>
+bool LRUCache<Key, Value, Alloc>::PutIfAbsent(const Key& key, const Value& value, uint32_t expire_at)
+{
+    auto it = _item_map.find(key);
+    if (it != _item_map.end()) {
+        uint32_t current_expiry = it->second->expire_at;
+        if (current_expiry == 0 || current_expiry > CacheClock::Now()) return false;
+    }
+    store(key, value, expire_at, false);
+    return true;
 }
 
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::PutAbsent(const Key& key, uint32_t expire_at)
+{
+    auto it = _item_map.find(key);
+    if (it != _item_map.end() && !it->second->absent) return;
+    store(key, Value(), expire_at, true);
+}
 
-template <typename Key, typename Value>
-void LRUCache<Key, Value>::Put(const Key& key, const Value& value)
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::ReplaceWithAbsent(const Key& key, uint32_t expire_at, CacheLookup seen, const Value& seen_value)
 {
-    // _mutex.lock() ;
+    Value current;
+    CacheLookup state = Peek(key, &current);
+    if (state == seen && (state != CacheLookup::Hit || current.SharesBuffer(seen_value))) {
+        store(key, Value(), expire_at, true);
+        return;
+    }
+    Erase(key);
+}
 
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::store(const Key& key, const Value& value, uint32_t expire_at, bool absent)
+{
+    // _mutex.lock() ;
     // If key exists, update value and move to front.
     auto it = _item_map.find(key);
     if (it != _item_map.end()) {
-        it->second->second = value;
+        Entry &entry = *it->second;
+        wheel_unlink(entry);
+        entry.value = value;
+        entry.expire_at = expire_at;
+        entry.absent = absent;
+        wheel_link(entry);
         _item_list.splice(_item_list.begin(), _item_list, it->second);
         // _mutex.unlock() ;
         return;
@@ -58,79 +203,250 @@ void LRUCache<Key, Value>::Put(const Key& key, const Value& value)
 
     // If cache is full, evict the least recently used item.
     if (_item_list.size() == _capacity) {
-        Key lru_key = _item_list.back().first;
-        _item_list.pop_back();
-        _item_map.erase(lru_key);
+        erase_entry(_item_map.find(_item_list.back().key));
+        ++_evictions;
     }
 
     // Add the new item to the front.
-    _item_list.emplace_front(key, value);
+    _item_list.push_front(Entry{key, value, expire_at, absent});
     _item_map[key] = _item_list.begin();
+    wheel_link(_item_list.front());
     // _mutex.unlock() ;
 }
 
 
-template <typename Key, typename Value>
-bool LRUCache<Key, Value>::Get(const Key& key, Value &ret_val) {
+template <typename Key, typename Value, typename Alloc>
+bool LRUCache<Key, Value, Alloc>::Get(const Key& key, Value &ret_val) {
+    return Lookup(key, ret_val) == CacheLookup::Hit;
+}
+
+template <typename Key, typename Value, typename Alloc>
+CacheLookup LRUCache<Key, Value, Alloc>::Lookup(const Key& key, Value &ret_val, uint32_t *expire_tick) {
     // _mutex.lock() ;
 
     auto it = _item_map.find(key);
     if (it == _item_map.end()) {
         // _mutex.unlock() ;
         // std::cout << "CACHE MISS \n" ;
-        return false ; // Cache Miss
+        return CacheLookup::Miss ; // Cache Miss
+    }
+
+    // Expired entries are dropped lazily, before the sweeper gets to them
+    uint32_t expire_at = it->second->expire_at;
+    if (expire_at != 0 && expire_at <= CacheClock::Now()) {
+        erase_entry(it);
+        return CacheLookup::Miss ; // Cache Miss
     }
 
     // std::cout << "CACHE HIT\n" ;
     // Move accessed item to the front of the list.
     _item_list.splice(_item_list.begin(), _item_list, it->second);
-    ret_val = it->second->second; // Cache Hit
+    if (it->second->absent)
+        return CacheLookup::Absent ; // Known to be missing from the DB
+    ret_val = it->second->value; // Cache Hit
+    if (expire_tick) *expire_tick = expire_at;
     // _mutex.unlock() ;
-    return true ;
+    return CacheLookup::Hit ;
 }
 
 
-template <typename Key, typename Value>
-void LRUCache<Key, Value>::Erase(const Key& key) {
+template <typename Key, typename Value, typename Alloc>
+CacheLookup LRUCache<Key, Value, Alloc>::Peek(const Key& key, Value *ret_val) const {
+    auto it = _item_map.find(key);
+    if (it == _item_map.end()) return CacheLookup::Miss;
+    uint32_t expire_at = it->second->expire_at;
+    if (expire_at != 0 && expire_at <= CacheClock::Now()) return CacheLookup::Miss;
+    if (it->second->absent) return CacheLookup::Absent;
+    if (ret_val) *ret_val = it->second->value;
+    return CacheLookup::Hit;
+}
+
+
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::Erase(const Key& key) {
     // _mutex.lock() ;
 
     auto it = _item_map.find(key);
-    if (it != _item_map.end()) {
-        _item_list.erase(it->second);
-        _item_map.erase(it);
-    }
+    if (it != _item_map.end()) erase_entry(it);
     // _mutex.unlock() ;
 }
 
-template <typename Key, typename Value>
-std::string LRUCache<Key, Value>::GetContents()
+template <typename Key, typename Value, typename Alloc>
+std::string LRUCache<Key, Value, Alloc>::GetContents()
 {
     // _mutex.lock() ;
     std::string body = "" ;
     // Iterate over the contents,a nd append to response
     for (auto &item : _item_list) {
+        if (item.absent) continue ;
         body += "Key = " ;
-        body += std::to_string(item.first) ;
+        body += std::to_string(item.key) ;
         body += " Value = " ;
-        body += item.second ;
+        body += item.value ;
         body += "\n" ;
     }
     // _mutex.unlock() ;
     return body ;
 }
 
+template <typename Key, typename Value, typename Alloc>
+template <typename Fn>
+void LRUCache<Key, Value, Alloc>::ForEachFromLRU(Fn&& fn)
+{
+    for (auto it = _item_list.rbegin(); it != _item_list.rend(); ++it) {
+        if (it->absent) continue;
+        fn(it->key, it->value, it->expire_at);
+    }
+}
+
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::wheel_link(Entry &entry)
+{
+    if (entry.expire_at == 0) return;
+    if (_wheel.empty()) {
+        _wheel.resize(WHEEL_SLOTS, nullptr);
+        _wheel_tick = CacheClock::Now();
+    }
+    Entry *&head = _wheel[entry.expire_at % WHEEL_SLOTS];
+    entry.wheel_prev = nullptr;
+    entry.wheel_next = head;
+    if (head) head->wheel_prev = &entry;
+    head = &entry;
+}
+
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::wheel_unlink(Entry &entry)
+{
+    // Every entry with an expiry is linked, into the slot of that expiry
+    if (entry.expire_at == 0) return;
+    if (entry.wheel_prev) entry.wheel_prev->wheel_next = entry.wheel_next;
+    else _wheel[entry.expire_at % WHEEL_SLOTS] = entry.wheel_next;
+    if (entry.wheel_next) entry.wheel_next->wheel_prev = entry.wheel_prev;
+    entry.wheel_prev = entry.wheel_next = nullptr;
+}
+
+template <typename Key, typename Value, typename Alloc>
+void LRUCache<Key, Value, Alloc>::erase_entry(typename ItemMap::iterator it)
+{
+    wheel_unlink(*it->second);
+    _item_list.erase(it->second);
+    _item_map.erase(it);
+}
+
+template <typename Key, typename Value, typename Alloc>
+size_t LRUCache<Key, Value, Alloc>::ExpireTick(uint32_t now)
+{
+    if (_wheel.empty()) return 0;
+
+    size_t erased = 0;
+    // After a long pause one revolution covers every slot
+    uint32_t first = std::max(_wheel_tick + 1, now >= WHEEL_SLOTS ? now - WHEEL_SLOTS + 1 : 0);
+    for (uint32_t tick = first; tick <= now; ++tick) {
+        Entry *entry = _wheel[tick % WHEEL_SLOTS];
+        while (entry) {
+            Entry *next = entry->wheel_next;
+            // Entries due in a later revolution stay where they are
+            if (entry->expire_at <= now) {
+                erase_entry(_item_map.find(entry->key));
+                ++erased;
+            }
+            entry = next;
+        }
+    }
+    _wheel_tick = std::max(_wheel_tick, now);
+    return erased;
+}
+
+// Point-in-time counters of one shard, used to spot imbalance between shards
+struct ShardStats {
+    size_t   size;
+    size_t   capacity;
+    uint64_t lookups;       // Get/Lookup calls
+    uint64_t hits;          // lookups that returned a value
+    uint64_t writes;        // Put/PutAbsent calls
+    uint64_t evictions;
+};
+
 class LRUShard {
 public:
-    LRUShard(size_t capacity) : _cache(capacity) {}
+    // Entries and the hash table live in the shard's own arena, placed on
+    // NUMA node `node` (< 0 leaves placement to the kernel). Values stored
+    // from bytes go to a SharedNumaArena on the same node.
+    LRUShard(size_t capacity, int node = -1)
+        : _arena(node), _cache(capacity, EntryAllocator(&_arena)) {}
 
     bool Get(long long key, std::string &value) {
+        return Lookup(key, value) == CacheLookup::Hit;
+    }
+
+    // A lookup reorders the LRU list (and may drop an expired entry), so it
+    // needs the lock exclusively like every other operation. Under the lock
+    // only the value handle is copied.
+    CacheLookup Lookup(long long key, SharedValue &value, uint32_t *expire_at = nullptr) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        CacheLookup result = _cache.Lookup(key, value, expire_at);
+        _lookups.store(_lookups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (result == CacheLookup::Hit)
+            _hits.store(_hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return result;
+    }
+
+    // Same, copying the bytes into `value` after the lock is released
+    CacheLookup Lookup(long long key, std::string &value, uint32_t *expire_at = nullptr) {
+        SharedValue handle;
+        CacheLookup result = Lookup(key, handle, expire_at);
+        if (result == CacheLookup::Hit) value.assign(handle.data(), handle.size());
+        return result;
+    }
+
+    // A probe that does not count as a read: shared lock, no reordering,
+    // no hit counters, and only a handle copy on a hit
+    CacheLookup Peek(long long key, SharedValue *value = nullptr) {
         std::shared_lock<std::shared_mutex> lock(_mutex);
-        return _cache.Get(key, value);
+        return _cache.Peek(key, value);
+    }
+
+    void PutAbsent(long long key, uint32_t expire_at) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        _cache.PutAbsent(key, expire_at);
+        _writes.store(_writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void ReplaceWithAbsent(long long key, uint32_t expire_at, CacheLookup seen, const SharedValue &seen_value) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        _cache.ReplaceWithAbsent(key, expire_at, seen, seen_value);
+        _writes.store(_writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void Put(long long key, const SharedValue &value, uint32_t expire_at = 0) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        _cache.Put(key, value, expire_at);
+        _writes.store(_writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // The bytes are copied into a new buffer, on the shard's node, before
+    // the lock is taken
+    void Put(long long key, std::string_view value, uint32_t expire_at = 0) {
+        Put(key, make_value(value), expire_at);
     }
 
-    void Put(long long key, const std::string &value) {
+    bool PutIfAbsent(long long key, std::string_view value, uint32_t expire_at = 0) {
+        SharedValue handle = make_value(value);
         std::unique_lock<std::shared_mutex> lock(_mutex);
-        _cache.Put(key, value);
+        _writes.store(_writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return _cache.PutIfAbsent(key, handle, expire_at);
+    }
+
+    ShardStats Stats() {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        return ShardStats{_cache.Size(), _cache.Capacity(), _lookups.load(std::memory_order_relaxed),
+                          _hits.load(std::memory_order_relaxed), _writes.load(std::memory_order_relaxed),
+                          _cache.Evictions()};
+    }
+
+    size_t ExpireTick(uint32_t now) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        return _cache.ExpireTick(now);
     }
 
     void Erase(long long key) {
@@ -138,20 +454,53 @@ public:
         _cache.Erase(key);
     }
 
+    // Hand out the live entries in LRU -> MRU order. Only value handles are
+    // taken under the lock; the (slow) file I/O of a snapshot happens without it.
+    std::vector<LRUEntry<long long, SharedValue>> Dump() {
+        std::vector<LRUEntry<long long, SharedValue>> out;
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        uint32_t now = CacheClock::Now();
+        out.reserve(_cache.Size());
+        _cache.ForEachFromLRU([&out, now](long long key, const SharedValue &value, uint32_t expire_at) {
+            if (expire_at == 0 || expire_at > now)
+                out.push_back(LRUEntry<long long, SharedValue>{key, value, expire_at, false});
+        });
+        return out;
+    }
+
+    int Node() const { return _arena.Node(); }
+
 private:
-    LRUCache<long long, std::string> _cache;
+    using EntryAllocator = NumaAllocator<LRUEntry<long long, SharedValue>>;
+
+    // Values can be released on any thread, so they come from the node's
+    // thread-safe SharedNumaArena rather than from _arena
+    SharedValue make_value(std::string_view bytes) const {
+        return SharedValue(bytes.data(), bytes.size(), SharedNumaArena::ForNode(_arena.Node()));
+    }
+
+    NumaArena _arena;       // declared first: _cache allocates from it
+    LRUCache<long long, SharedValue, EntryAllocator> _cache;
     mutable std::shared_mutex _mutex;
+    // Only written under _mutex; atomic so Stats() readers never tear
+    std::atomic<uint64_t> _lookups{0}, _hits{0}, _writes{0};
 };
 
 class ShardedLRUCache {
 public:
-    ShardedLRUCache(size_t total_capacity, size_t shard_count)
-        : _shard_count(shard_count)
+    // `shard_count` is rounded up to a power of two; 0 picks DefaultShardCount(total_capacity).
+    // With `numa_aware`, shard i keeps its memory on NUMA node i % nodes.
+    ShardedLRUCache(size_t total_capacity, size_t shard_count, bool numa_aware = false)
+        : _shard_count(shard_count == 0 ? DefaultShardCount(total_capacity) : shard_count)
     {
-        if (_shard_count == 0) _shard_count = 1;
+        size_t rounded = 1;
+        while (rounded < _shard_count) rounded <<= 1;
+        _shard_count = rounded;
+        _shard_mask = _shard_count - 1;
         size_t per_shard = std::max<size_t>(1, total_capacity / _shard_count);
+        int nodes = NumaTopology::Get().Nodes();
         for (size_t i = 0; i < _shard_count; ++i)
-            _shards.push_back(std::make_unique<LRUShard>(per_shard));
+            _shards.push_back(std::make_unique<LRUShard>(per_shard, numa_aware ? static_cast<int>(i % nodes) : -1));
     }
 
     bool Get(long long key, std::string &value) {
@@ -161,11 +510,58 @@ public:
         return _shards[shard_of(key)]->Get(key, value);
     }
 
-    void Put(long long key, const std::string &value) {
+    // Store `value` for `ttl_sec` seconds (0 = until evicted)
+    void Put(long long key, std::string_view value, uint32_t ttl_sec = 0) {
         // if (key == 1) {
         //     std::cout << "PUT SHARD " << shard_of(key) << std::endl ;
         // }
-        _shards[shard_of(key)]->Put(key, value);
+        _shards[shard_of(key)]->Put(key, value, CacheClock::ExpiryAfter(ttl_sec));
+    }
+
+    // Shares an existing buffer, wherever it was allocated
+    void Put(long long key, const SharedValue &value, uint32_t ttl_sec = 0) {
+        _shards[shard_of(key)]->Put(key, value, CacheClock::ExpiryAfter(ttl_sec));
+    }
+
+    // Fill `key` only if the cache holds nothing live for it: used for data
+    // read from the DB some time ago (warm-up), which must not replace a
+    // newer PUT or the tombstone of a newer DELETE. Returns true if stored.
+    bool PutIfAbsent(long long key, std::string_view value, uint32_t ttl_sec = 0) {
+        return _shards[shard_of(key)]->PutIfAbsent(key, value, CacheClock::ExpiryAfter(ttl_sec));
+    }
+
+    CacheLookup Lookup(long long key, std::string &value, uint32_t *expire_at = nullptr) {
+        return _shards[shard_of(key)]->Lookup(key, value, expire_at);
+    }
+
+    // Returns a handle to the cached buffer instead of a copy of it
+    CacheLookup Lookup(long long key, SharedValue &value, uint32_t *expire_at = nullptr) {
+        return _shards[shard_of(key)]->Lookup(key, value, expire_at);
+    }
+
+    // Negative caching: remember for `ttl_sec` seconds that `key` is not in
+    // the DB. A tombstone never replaces a cached value, so a GET that raced
+    // with a PUT cannot hide the freshly written value.
+    void PutAbsent(long long key, uint32_t ttl_sec) {
+        if (ttl_sec == 0) return;
+        _shards[shard_of(key)]->PutAbsent(key, CacheClock::ExpiryAfter(ttl_sec));
+    }
+
+    // State of `key` without counting as a read (see LRUShard::Peek)
+    CacheLookup Peek(long long key, SharedValue *value = nullptr) {
+        return _shards[shard_of(key)]->Peek(key, value);
+    }
+
+    // After a DELETE: tombstone `key` if the entry is still the one Peek()
+    // returned before the DB call. If a PUT replaced it meanwhile, that PUT
+    // may have committed after the delete, so the entry is only erased and
+    // the next GET asks the DB.
+    void ReplaceWithAbsent(long long key, uint32_t ttl_sec, CacheLookup seen, const SharedValue &seen_value) {
+        if (ttl_sec == 0) {
+            Erase(key);
+            return;
+        }
+        _shards[shard_of(key)]->ReplaceWithAbsent(key, CacheClock::ExpiryAfter(ttl_sec), seen, seen_value);
     }
 
     void Erase(long long key) {
@@ -175,15 +571,239 @@ public:
         _shards[shard_of(key)]->Erase(key);
     }
 
+    // Background expiry sweep, meant to be called about once per second.
+    // Returns the number of entries that expired.
+    size_t ExpireTick() {
+        uint32_t now = CacheClock::Now();
+        size_t erased = 0;
+        for (auto &shard : _shards)
+            erased += shard->ExpireTick(now);
+        return erased;
+    }
+
+    size_t ShardCount() const { return _shard_count; }
+    int NodeOfShard(size_t shard) const { return _shards[shard]->Node(); }
+    size_t ShardOf(long long key) const { return shard_of(key); }
+
+    // A few shards per hardware thread keeps the odds of two threads wanting
+    // the same shard lock low, but every shard keeps at least
+    // MIN_SHARD_CAPACITY entries: in tiny shards the normal imbalance between
+    // shards turns into early evictions.
+    static constexpr size_t MIN_SHARD_CAPACITY = 1024;
+
+    static size_t DefaultShardCount(size_t total_capacity) {
+        size_t target = 4 * std::max(1u, std::thread::hardware_concurrency());
+        size_t count = 1;
+        while (count < target) count <<= 1;
+        while (count > 1 && total_capacity / count < MIN_SHARD_CAPACITY) count >>= 1;
+        return count;
+    }
+
+    std::vector<ShardStats> Stats() {
+        std::vector<ShardStats> stats;
+        stats.reserve(_shard_count);
+        for (auto &shard : _shards)
+            stats.push_back(shard->Stats());
+        return stats;
+    }
+
+    // Persist every shard to `path` (written to a temp file, then renamed).
+    // Returns the number of entries written, or -1 on I/O failure.
+    long long SaveSnapshot(const std::string &path);
+
+    // Reload a snapshot written by SaveSnapshot(). Each shard section is
+    // read by its own thread. Returns the number of entries loaded, or -1 if
+    // the file is missing or malformed; a malformed file loads nothing.
+    long long LoadSnapshot(const std::string &path);
+
 private:
+    // std::hash<long long> is the identity on libstdc++, so sequential or
+    // strided keys would map to shards in lockstep. The splitmix64 finaliser
+    // spreads every input bit over the whole word before masking.
+    static uint64_t mix_hash(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
     size_t shard_of(long long key) const {
-        return std::hash<long long>{}(key) % _shard_count;
+        return mix_hash(static_cast<uint64_t>(key)) & _shard_mask;
     }
 
     size_t _shard_count;
+    size_t _shard_mask;
     std::vector<std::unique_ptr<LRUShard>> _shards;
 };
 
+// --------------------------- Snapshot file format ---------------------------
+//
+//   header  : magic "KVSNAP01" | u32 version | u32 section count
+//   section : u64 entry count | u64 payload bytes | payload
+//   payload : { i64 key | i64 expiry | u32 value length | value bytes } * entry count
+//
+// One section per shard, entries in LRU -> MRU order. The expiry is a Unix
+// time in seconds (0 = none) since CacheClock ticks do not survive a restart.
+// Integers are stored in host byte order; a snapshot is only meant to be
+// reloaded on the same host.
+
+static const char   SNAPSHOT_MAGIC[8]  = {'K', 'V', 'S', 'N', 'A', 'P', '0', '1'};
+static const uint32_t SNAPSHOT_VERSION = 2;
+
+static inline int64_t snapshot_wall_now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline long long ShardedLRUCache::SaveSnapshot(const std::string &path)
+{
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) return -1;
+
+    uint32_t version = SNAPSHOT_VERSION;
+    uint32_t sections = static_cast<uint32_t>(_shard_count);
+    out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char*>(&sections), sizeof(sections));
+
+    long long total = 0;
+    std::string payload;
+    int64_t wall_now = snapshot_wall_now();
+    uint32_t tick_now = CacheClock::Now();
+    for (auto &shard : _shards) {
+        auto entries = shard->Dump();
+        payload.clear();
+        for (auto &entry : entries) {
+            int64_t key = entry.key;
+            int64_t expiry = entry.expire_at == 0 ? 0 : wall_now + (entry.expire_at - tick_now);
+            uint32_t len = static_cast<uint32_t>(entry.value.size());
+            payload.append(reinterpret_cast<const char*>(&key), sizeof(key));
+            payload.append(reinterpret_cast<const char*>(&expiry), sizeof(expiry));
+            payload.append(reinterpret_cast<const char*>(&len), sizeof(len));
+            payload.append(entry.value.data(), entry.value.size());
+        }
+        uint64_t count = entries.size();
+        uint64_t bytes = payload.size();
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+        out.write(payload.data(), payload.size());
+        total += count;
+    }
+
+    out.flush();
+    if (!out) return -1;
+    out.close();
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) return -1;
+    return total;
+}
+
+inline long long ShardedLRUCache::LoadSnapshot(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return -1;
+
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint32_t version = 0, sections = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&sections), sizeof(sections));
+    if (!in || std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || version != SNAPSHOT_VERSION)
+        return -1;
+
+    std::streamoff header_end = in.tellg();
+    in.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(in.tellg());
+    in.seekg(header_end);
+
+    // Walk the section headers once to find where each payload starts. The
+    // lengths come from the file, so a truncated or corrupt one is rejected
+    // here, before anything is allocated for it or put into the cache.
+    const uint64_t entry_header = sizeof(int64_t) + sizeof(int64_t) + sizeof(uint32_t);
+    struct Section { std::streamoff offset; uint64_t count; uint64_t bytes; };
+    std::vector<Section> index;
+    for (uint32_t i = 0; i < sections; ++i) {
+        Section s{};
+        in.read(reinterpret_cast<char*>(&s.count), sizeof(s.count));
+        in.read(reinterpret_cast<char*>(&s.bytes), sizeof(s.bytes));
+        if (!in) return -1;
+        s.offset = in.tellg();
+        uint64_t offset = static_cast<uint64_t>(s.offset);
+        if (offset > file_size || s.bytes > file_size - offset || s.count > s.bytes / entry_header) return -1;
+        in.seekg(static_cast<std::streamoff>(s.bytes), std::ios::cur);
+        index.push_back(s);
+    }
+    in.close();
+
+    // Entries are routed through Put(), so a snapshot taken with a different
+    // shard count still loads; with the same count each thread owns one shard.
+    // A section is checked in full before any of its entries is stored; the
+    // keys each thread stored are kept so that a failure in another section
+    // (or a read error) can take them out again.
+    size_t n_threads = std::min<size_t>(index.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::vector<int64_t>> stored(n_threads);
+    std::atomic<size_t> next{0};
+    std::atomic<long long> loaded{0};
+    std::atomic<bool> failed{false};
+    int64_t wall_now = snapshot_wall_now();
+    auto loader = [&](std::vector<int64_t> &keys) {
+        std::ifstream file(path, std::ios::binary);
+        std::string payload;
+        for (size_t i = next.fetch_add(1); i < index.size() && !failed; i = next.fetch_add(1)) {
+            const Section &s = index[i];
+            payload.resize(s.bytes);
+            file.seekg(s.offset);
+            file.read(&payload[0], static_cast<std::streamsize>(s.bytes));
+            if (!file) { failed = true; return; }
+
+            size_t pos = 0;
+            for (uint64_t n = 0; n < s.count; ++n) {
+                uint32_t len;
+                if (pos + entry_header > payload.size()) { failed = true; return; }
+                std::memcpy(&len, payload.data() + pos + 2 * sizeof(int64_t), sizeof(len));
+                pos += entry_header;
+                if (len > payload.size() - pos) { failed = true; return; }
+                pos += len;
+            }
+            if (pos != payload.size()) { failed = true; return; }
+
+            long long count = 0;
+            for (pos = 0; pos < payload.size(); ) {
+                int64_t key, expiry;
+                uint32_t len;
+                std::memcpy(&key, payload.data() + pos, sizeof(key));
+                pos += sizeof(key);
+                std::memcpy(&expiry, payload.data() + pos, sizeof(expiry));
+                pos += sizeof(expiry);
+                std::memcpy(&len, payload.data() + pos, sizeof(len));
+                pos += sizeof(len);
+                // Entries that expired while the server was down are skipped
+                if (expiry == 0 || expiry > wall_now) {
+                    Put(key, std::string_view(payload.data() + pos, len), expiry == 0 ? 0 : static_cast<uint32_t>(expiry - wall_now));
+                    keys.push_back(key);
+                    ++count;
+                }
+                pos += len;
+            }
+            loaded.fetch_add(count);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; ++i)
+        threads.emplace_back(loader, std::ref(stored[i]));
+    for (auto &t : threads)
+        t.join();
+
+    if (!failed) return loaded.load();
+    for (auto &keys : stored)
+        for (int64_t key : keys) Erase(key);
+    return -1;
+}
+
 
 
 #endif
@@ -0,0 +1,167 @@
+#ifndef Metrics_H
+#define Metrics_H
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <sched.h>
+
+
+// Counters and latency histograms for the /metrics endpoint. Each one is
+// split into per-CPU stripes on their own cache lines: recording is a
+// relaxed add on the current CPU's stripe, which no other core writes in
+// the common case, and the stripes are only summed when /metrics is scraped.
+
+// Histogram bucket upper bounds in microseconds, 50 us .. 2.5 s (plus +Inf)
+static const uint64_t METRICS_LATENCY_BOUNDS_US[] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000};
+static const size_t METRICS_LATENCY_BUCKETS = sizeof(METRICS_LATENCY_BOUNDS_US) / sizeof(METRICS_LATENCY_BOUNDS_US[0]) + 1;
+
+inline size_t metrics_stripe_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline size_t metrics_stripe(size_t stripes)
+{
+    int cpu = sched_getcpu();
+    return (cpu < 0 ? 0 : static_cast<size_t>(cpu)) % stripes;
+}
+
+inline uint64_t elapsed_us(std::chrono::steady_clock::time_point since)
+{
+    auto elapsed = std::chrono::steady_clock::now() - since;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+
+class StripedCounter {
+public:
+    StripedCounter() : _stripes(metrics_stripe_count()) {}
+
+    void Add(uint64_t n = 1) {
+        _stripes[metrics_stripe(_stripes.size())].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t Value() const {
+        uint64_t total = 0;
+        for (auto &stripe : _stripes) total += stripe.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> value{0};
+    };
+    std::vector<Stripe> _stripes;
+};
+
+
+// Sum of the stripes of a StripedHistogram at scrape time
+struct HistogramSnapshot {
+    uint64_t buckets[METRICS_LATENCY_BUCKETS] = {};    // per bucket, not cumulative; the last is +Inf
+    uint64_t count = 0;
+    uint64_t sum_us = 0;
+};
+
+class StripedHistogram {
+public:
+    StripedHistogram() : _stripes(metrics_stripe_count()) {}
+
+    void Observe(uint64_t us) {
+        const uint64_t *end = METRICS_LATENCY_BOUNDS_US + METRICS_LATENCY_BUCKETS - 1;
+        size_t bucket = static_cast<size_t>(std::lower_bound(METRICS_LATENCY_BOUNDS_US, end, us) - METRICS_LATENCY_BOUNDS_US);
+        Stripe &stripe = _stripes[metrics_stripe(_stripes.size())];
+        stripe.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        stripe.sum_us.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot Collect() const {
+        HistogramSnapshot snapshot;
+        for (auto &stripe : _stripes) {
+            for (size_t i = 0; i < METRICS_LATENCY_BUCKETS; ++i) {
+                uint64_t n = stripe.buckets[i].load(std::memory_order_relaxed);
+                snapshot.buckets[i] += n;
+                snapshot.count += n;
+            }
+            snapshot.sum_us += stripe.sum_us.load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> buckets[METRICS_LATENCY_BUCKETS] = {};
+        std::atomic<uint64_t> sum_us{0};
+    };
+    std::vector<Stripe> _stripes;
+};
+
+// Observes the time from construction to destruction
+class ScopedLatency {
+public:
+    explicit ScopedLatency(StripedHistogram &histogram)
+        : _histogram(histogram), _start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() { _histogram.Observe(elapsed_us(_start)); }
+
+private:
+    StripedHistogram &_histogram;
+    std::chrono::steady_clock::time_point _start;
+};
+
+
+// Prometheus text exposition format (version 0.0.4). `labels` is either
+// empty or a list like `route="get",code="2xx"`, without braces.
+class MetricsWriter {
+public:
+    explicit MetricsWriter(std::ostream &out) : _out(out) {}
+
+    // Starts a metric family; every sample of the family must follow it
+    void Family(const std::string &name, const char *type, const char *help) {
+        _out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    }
+
+    void Sample(const std::string &name, const std::string &labels, uint64_t value) {
+        write(name, labels, std::to_string(value));
+    }
+
+    void Sample(const std::string &name, const std::string &labels, double value) {
+        write(name, labels, std::to_string(value));
+    }
+
+    // Cumulative _bucket samples in seconds, then _sum and _count
+    void Histogram(const std::string &name, const std::string &labels, const HistogramSnapshot &snapshot) {
+        std::string prefix = labels.empty() ? "" : labels + ",";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < METRICS_LATENCY_BUCKETS; ++i) {
+            cumulative += snapshot.buckets[i];
+            std::string le = i + 1 < METRICS_LATENCY_BUCKETS ? seconds(METRICS_LATENCY_BOUNDS_US[i]) : "+Inf";
+            _out << name << "_bucket{" << prefix << "le=\"" << le << "\"} " << cumulative << "\n";
+        }
+        Sample(name + "_sum", labels, snapshot.sum_us / 1e6);
+        Sample(name + "_count", labels, snapshot.count);
+    }
+
+private:
+    void write(const std::string &name, const std::string &labels, const std::string &value) {
+        _out << name;
+        if (!labels.empty()) _out << "{" << labels << "}";
+        _out << " " << value << "\n";
+    }
+
+    static std::string seconds(uint64_t us) {
+        std::string s = std::to_string(us / 1000000) + "." + std::to_string(1000000 + us % 1000000).substr(1);
+        while (s.back() == '0') s.pop_back();
+        if (s.back() == '.') s.pop_back();
+        return s;
+    }
+
+    std::ostream &_out;
+};
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef Numa_H
+#define Numa_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <algorithm>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+
+// NUMA topology read from sysfs, plus the two primitives the cache needs:
+// placing a memory range on a node and pinning a thread to a node's CPUs.
+// Uses raw syscalls so the build does not depend on libnuma.
+class NumaTopology {
+public:
+    static const NumaTopology &Get() {
+        static const NumaTopology topology;
+        return topology;
+    }
+
+    int Nodes() const                                   { return static_cast<int>(_node_cpus.size()) ; }
+    const std::vector<int> &CpusOfNode(int node) const  { return _node_cpus[node] ; }
+
+    int NodeOfCpu(int cpu) const {
+        if (cpu < 0 || cpu >= static_cast<int>(_cpu_node.size())) return 0;
+        return _cpu_node[cpu];
+    }
+
+    // Node of the CPU the calling thread is running on right now
+    int CurrentNode() const { return NodeOfCpu(sched_getcpu()); }
+
+    // Ask the kernel to back [addr, addr + len) with pages from `node`
+    // (preferred, so allocation still succeeds when the node is full).
+    static bool BindMemory(void *addr, size_t len, int node) {
+        if (node < 0) return false;
+        const unsigned long MPOL_PREFERRED_MODE = 1;
+        unsigned long mask[16] = {0};
+        if (node >= static_cast<int>(sizeof(mask) * 8)) return false;
+        mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+        return syscall(SYS_mbind, addr, len, MPOL_PREFERRED_MODE, mask, sizeof(mask) * 8, 0) == 0;
+    }
+
+    // Restrict the calling thread to the CPUs of `node`
+    bool PinThreadToNode(int node) const {
+        if (node < 0 || node >= Nodes()) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : _node_cpus[node]) CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+private:
+    NumaTopology() {
+        for (int node = 0; ; ++node) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!in) break;
+            std::string list;
+            std::getline(in, list);
+            _node_cpus.push_back(parse_cpulist(list));
+        }
+        // No sysfs (or no NUMA support): one node holding every CPU
+        if (_node_cpus.empty()) {
+            std::vector<int> all;
+            long n = sysconf(_SC_NPROCESSORS_CONF);
+            for (long cpu = 0; cpu < std::max(1L, n); ++cpu) all.push_back(static_cast<int>(cpu));
+            _node_cpus.push_back(all);
+        }
+        for (int node = 0; node < Nodes(); ++node) {
+            for (int cpu : _node_cpus[node]) {
+                if (cpu >= static_cast<int>(_cpu_node.size())) _cpu_node.resize(cpu + 1, 0);
+                _cpu_node[cpu] = node;
+            }
+        }
+    }
+
+    // "0-3,8-11" -> {0,1,2,3,8,9,10,11}
+    static std::vector<int> parse_cpulist(const std::string &list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty()) continue;
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    std::vector<std::vector<int>> _node_cpus;
+    std::vector<int> _cpu_node;
+};
+
+
+// Pool of small and medium blocks (up to 64 KiB) whose backing chunks are
+// mmap'd and placed on one NUMA node (or left to the kernel when node < 0).
+// Blocks are recycled through per-size free lists: 16-byte classes up to
+// 512 bytes, power-of-two classes above. Larger blocks get their own pages.
+// Not thread-safe: each arena belongs to one cache shard and is only used
+// under that shard's lock (see SharedNumaArena otherwise).
+class NumaArena {
+public:
+    explicit NumaArena(int node = -1) : _node(node) {}
+
+    NumaArena(const NumaArena &) = delete;
+    NumaArena &operator=(const NumaArena &) = delete;
+
+    ~NumaArena() {
+        for (auto &chunk : _chunks) munmap(chunk.first, chunk.second);
+    }
+
+    void *Allocate(size_t bytes) {
+        if (bytes > MAX_MEDIUM) return map_pages(round_pages(bytes));
+        size_t cls = size_class(bytes);
+        if (FreeBlock *block = _free[cls]) {
+            _free[cls] = block->next;
+            return block;
+        }
+        size_t size = class_bytes(cls);
+        if (_bump + size > _bump_end) {
+            char *chunk = static_cast<char*>(map_pages(CHUNK_BYTES));
+            _chunks.emplace_back(chunk, CHUNK_BYTES);
+            _bump = chunk;
+            _bump_end = chunk + CHUNK_BYTES;
+        }
+        void *p = _bump;
+        _bump += size;
+        return p;
+    }
+
+    void Deallocate(void *p, size_t bytes) {
+        if (!p) return;
+        if (bytes > MAX_MEDIUM) {
+            munmap(p, round_pages(bytes));
+            return;
+        }
+        size_t cls = size_class(bytes);
+        FreeBlock *block = static_cast<FreeBlock*>(p);
+        block->next = _free[cls];
+        _free[cls] = block;
+    }
+
+    int Node() const { return _node; }
+
+private:
+    struct FreeBlock { FreeBlock *next; };
+
+    static constexpr size_t GRANULE       = 16;
+    static constexpr size_t MAX_SMALL     = 512;
+    static constexpr size_t SMALL_CLASSES = MAX_SMALL / GRANULE;
+    static constexpr size_t MAX_MEDIUM    = 64 << 10;
+    static constexpr size_t CLASSES       = SMALL_CLASSES + 7;      // 1 KiB .. 64 KiB
+    static constexpr size_t CHUNK_BYTES   = 1 << 20;
+
+    static size_t size_class(size_t bytes) {
+        if (bytes <= MAX_SMALL) return (std::max<size_t>(bytes, 1) - 1) / GRANULE;
+        size_t cls = SMALL_CLASSES;
+        while (class_bytes(cls) < bytes) ++cls;
+        return cls;
+    }
+
+    static size_t class_bytes(size_t cls) {
+        return cls < SMALL_CLASSES ? (cls + 1) * GRANULE : (MAX_SMALL * 2) << (cls - SMALL_CLASSES);
+    }
+
+    static size_t round_pages(size_t bytes) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return (bytes + page - 1) / page * page;
+    }
+
+    void *map_pages(size_t bytes) {
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        // Placement must be set before the first touch faults the pages in
+        if (_node >= 0) NumaTopology::BindMemory(p, bytes, _node);
+        return p;
+    }
+
+    int _node;
+    FreeBlock *_free[CLASSES] = {nullptr};
+    char *_bump = nullptr;
+    char *_bump_end = nullptr;
+    std::vector<std::pair<void*, size_t>> _chunks;
+};
+
+
+// NumaArena behind a mutex, for blocks released by whichever thread drops
+// the last reference to them (cache values). Each node has a few of these,
+// picked by the allocating CPU, so concurrent writers rarely share a lock.
+// They are never destroyed: a block may outlive any cache it was stored in.
+class SharedNumaArena {
+public:
+    // An arena on `node` for the calling CPU, or nullptr when node < 0
+    static SharedNumaArena *ForNode(int node) {
+        // Deliberately leaked, like the arenas themselves
+        static const std::vector<SharedNumaArena*> *arenas = create_all();
+        int nodes = NumaTopology::Get().Nodes();
+        if (node < 0 || node >= nodes) return nullptr;
+        int cpu = sched_getcpu();
+        return (*arenas)[static_cast<size_t>(node) * STRIPES + static_cast<size_t>(cpu < 0 ? 0 : cpu) % STRIPES];
+    }
+
+    void *Allocate(size_t bytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _arena.Allocate(bytes);
+    }
+
+    void Deallocate(void *p, size_t bytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _arena.Deallocate(p, bytes);
+    }
+
+private:
+    static constexpr size_t STRIPES = 8;
+
+    explicit SharedNumaArena(int node) : _arena(node) {}
+
+    static std::vector<SharedNumaArena*> *create_all() {
+        auto *arenas = new std::vector<SharedNumaArena*>();
+        for (int node = 0; node < NumaTopology::Get().Nodes(); ++node)
+            for (size_t i = 0; i < STRIPES; ++i) arenas->push_back(new SharedNumaArena(node));
+        return arenas;
+    }
+
+    std::mutex _mutex;
+    NumaArena _arena;
+};
+
+
+// std-compatible allocator drawing from a NumaArena
+template <typename T>
+class NumaAllocator {
+public:
+    using value_type = T;
+
+    explicit NumaAllocator(NumaArena *arena) : _arena(arena) {}
+    template <typename U>
+    NumaAllocator(const NumaAllocator<U> &other) : _arena(other.arena()) {}
+
+    T *allocate(size_t n)                   { return static_cast<T*>(_arena->Allocate(n * sizeof(T))) ; }
+    void deallocate(T *p, size_t n)         { _arena->Deallocate(p, n * sizeof(T)) ; }
+
+    NumaArena *arena() const                { return _arena ; }
+
+    template <typename U>
+    bool operator==(const NumaAllocator<U> &other) const { return _arena == other.arena() ; }
+    template <typename U>
+    bool operator!=(const NumaAllocator<U> &other) const { return _arena != other.arena() ; }
+
+private:
+    NumaArena *_arena;
+};
+
+#endif
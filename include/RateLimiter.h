@@ -0,0 +1,260 @@
+#ifndef RateLimiter_H
+#define RateLimiter_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+
+// Sustained rate and burst size of one client
+struct RateLimit {
+    double   rate = 0 ;         // requests per second, 0 = unlimited
+    uint32_t burst = 1 ;        // requests that may arrive back to back
+};
+
+struct RateLimiterOptions {
+    RateLimit default_limit ;                               // applies to every client without an override
+    std::unordered_map<std::string, RateLimit> overrides ;  // per client (IP or API key)
+    size_t   max_clients = 4096 ;                           // clients tracked at once, idle ones make room for new ones
+};
+
+struct RateLimiterClientStats {
+    std::string client;
+    uint64_t    allowed;
+    uint64_t    rejected;
+};
+
+
+// Per-client token buckets, implemented as GCRA (generic cell rate
+// algorithm): a bucket is a single "theoretical arrival time" that moves
+// forward by 1/rate per admitted request, and a request is rejected when
+// that time runs more than `burst` intervals ahead of now. Admission is one
+// CAS on that timestamp, so clients never contend on a shared lock.
+//
+// Buckets live in a fixed open-addressed table claimed with a CAS on the
+// client's hash. Clients with an override get their bucket when the limiter
+// is built and keep it. When a new client finds no free bucket near its
+// slot, it takes over the one there that has been idle longest (the lowest
+// arrival time): a bucket whose arrival time has passed is full again, so
+// dropping it only loses its /stats counters. Callers hold a reference on
+// the bucket they use, and a bucket is only taken over while nobody holds
+// one. A bucket still over its limit is never taken over, as that would
+// hand its client a fresh burst. New clients share an overflow bucket with
+// the default limit when every bucket near their slot is in use or over
+// its limit.
+//
+// The overrides map is built before the server starts and only read after.
+class RateLimiter {
+public:
+    explicit RateLimiter(const RateLimiterOptions &options)
+        : _options(options),
+          _capacity(round_pow2(std::max<size_t>(16, (options.max_clients + options.overrides.size()) * 2))),
+          _buckets(new Bucket[_capacity]),
+          _max_probes(MAX_PROBES)
+    {
+        int64_t now = now_ns();
+        init_bucket(_overflow, "(overflow)", _options.default_limit, now);
+        // The table is at most half full of overrides, so this always finds room
+        for (auto &o : _options.overrides) {
+            uint64_t hash = hash_of(o.first);
+            for (size_t probe = 0;; ++probe) {
+                Bucket &bucket = _buckets[(hash + probe) & (_capacity - 1)];
+                if (bucket.state.load(std::memory_order_relaxed) != EMPTY) continue;
+                bucket.pinned = true;
+                bucket.hash.store(hash, std::memory_order_relaxed);
+                init_bucket(bucket, o.first, o.second, now);
+                _max_probes = std::max(_max_probes, probe + 1);
+                break;
+            }
+        }
+    }
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // True when no client is limited at all
+    bool Enabled() const {
+        if (_options.default_limit.rate > 0) return true;
+        for (auto &o : _options.overrides) if (o.second.rate > 0) return true;
+        return false;
+    }
+
+    // Charge one request to `client`. On rejection `retry_after_ms` tells
+    // when the next request would be admitted.
+    bool Allow(const std::string &client, uint64_t &retry_after_ms) {
+        int64_t now = now_ns();
+        Bucket &bucket = find_or_claim(client, now);
+        Hold hold(bucket);
+        retry_after_ms = 0;
+        if (bucket.interval_ns == 0) {
+            // Unlimited: the arrival time only records when the client was last seen
+            bucket.tat.store(now, std::memory_order_relaxed);
+            bucket.allowed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        int64_t tat = bucket.tat.load(std::memory_order_relaxed);
+        for (;;) {
+            int64_t new_tat = std::max(tat, now) + bucket.interval_ns;
+            int64_t ahead = new_tat - now - bucket.tolerance_ns;
+            if (ahead > 0) {
+                bucket.rejected.fetch_add(1, std::memory_order_relaxed);
+                _rejected.fetch_add(1, std::memory_order_relaxed);
+                retry_after_ms = static_cast<uint64_t>((ahead + 999999) / 1000000);
+                return false;
+            }
+            if (bucket.tat.compare_exchange_weak(tat, new_tat, std::memory_order_relaxed)) break;
+        }
+        bucket.allowed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t Rejected() const { return _rejected.load(std::memory_order_relaxed); }
+
+    // Counters of every tracked client
+    std::vector<RateLimiterClientStats> Stats() {
+        std::vector<RateLimiterClientStats> stats;
+        auto add = [&stats](Bucket &b) {
+            b.refs.fetch_add(1);
+            Hold hold(b);
+            if (b.state.load() != READY) return;
+            stats.push_back(RateLimiterClientStats{b.name, b.allowed.load(std::memory_order_relaxed),
+                                                   b.rejected.load(std::memory_order_relaxed)});
+        };
+        for (size_t i = 0; i < _capacity; ++i) add(_buckets[i]);
+        if (_overflow.allowed.load(std::memory_order_relaxed) || _overflow.rejected.load(std::memory_order_relaxed))
+            add(_overflow);
+        return stats;
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0;
+    static constexpr uint32_t CLAIMING = 1;
+    static constexpr uint32_t READY = 2;
+    static constexpr size_t   MAX_PROBES = 16;
+    static constexpr size_t   MAX_TAKE_OVERS = 4;
+    static constexpr size_t   NAME_BYTES = 47;
+
+    // Everything but state, refs, hash and tat is written only while the
+    // bucket is CLAIMING and nobody holds a reference
+    struct alignas(64) Bucket {
+        std::atomic<uint32_t> state{EMPTY};
+        std::atomic<uint32_t> refs{0};      // callers using the bucket right now
+        std::atomic<uint64_t> hash{0};
+        bool     pinned = false;            // an override's bucket, never taken over
+        int64_t  interval_ns = 0;           // 1 / rate, 0 = unlimited
+        int64_t  tolerance_ns = 0;          // burst * interval
+        std::atomic<int64_t>  tat{0};       // theoretical arrival time, last use when unlimited
+        std::atomic<uint64_t> allowed{0};
+        std::atomic<uint64_t> rejected{0};
+        char name[NAME_BYTES + 1] = {0};    // client, truncated, for /stats
+    };
+
+    // Drops a reference taken by find_or_claim() or Stats()
+    struct Hold {
+        explicit Hold(Bucket &bucket) : _bucket(bucket) {}
+        ~Hold() { _bucket.refs.fetch_sub(1, std::memory_order_release); }
+        Bucket &_bucket;
+    };
+
+    static size_t round_pow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 0 marks "no hash" in an empty bucket
+    static uint64_t hash_of(const std::string &client) { return std::hash<std::string>()(client) | 1; }
+
+    // A full bucket: an arrival time of `now` admits `burst` requests at once
+    void init_bucket(Bucket &bucket, const std::string &client, const RateLimit &limit, int64_t now) {
+        std::memset(bucket.name, 0, sizeof(bucket.name));
+        std::strncpy(bucket.name, client.c_str(), NAME_BYTES);
+        bucket.interval_ns = limit.rate > 0 ? static_cast<int64_t>(1e9 / limit.rate) : 0;
+        bucket.tolerance_ns = bucket.interval_ns * std::max<uint32_t>(1, limit.burst);
+        bucket.tat.store(now, std::memory_order_relaxed);
+        bucket.allowed.store(0, std::memory_order_relaxed);
+        bucket.rejected.store(0, std::memory_order_relaxed);
+        bucket.state.store(READY, std::memory_order_release);
+    }
+
+    // Gives a CLAIMING bucket to `client`, returned with a reference held
+    Bucket &assign(Bucket &bucket, const std::string &client, uint64_t hash, int64_t now) {
+        bucket.refs.fetch_add(1, std::memory_order_relaxed);
+        bucket.hash.store(hash, std::memory_order_relaxed);
+        auto it = _options.overrides.find(client);
+        init_bucket(bucket, client, it != _options.overrides.end() ? it->second : _options.default_limit, now);
+        return bucket;
+    }
+
+    // Takes a reference on `bucket` if it belongs to `client`. The reference
+    // is taken before checking, so the bucket cannot be taken over between
+    // the check and its use (see take_over()).
+    static bool hold_if_owner(Bucket &bucket, const std::string &client, uint64_t hash) {
+        bucket.refs.fetch_add(1);
+        if (bucket.state.load() == READY && bucket.hash.load(std::memory_order_relaxed) == hash &&
+            std::strncmp(bucket.name, client.c_str(), NAME_BYTES) == 0) return true;
+        bucket.refs.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    // Moves an unused, full bucket back to CLAIMING so it can be reassigned.
+    // Only holders move the arrival time, so once nobody holds the bucket the
+    // check below stays true until it is reassigned.
+    static bool take_over(Bucket &bucket, int64_t now) {
+        uint32_t state = READY;
+        if (!bucket.state.compare_exchange_strong(state, CLAIMING)) return false;
+        if (bucket.refs.load() == 0 && bucket.tat.load(std::memory_order_relaxed) <= now) return true;
+        bucket.state.store(READY, std::memory_order_release);
+        return false;
+    }
+
+    // The client's bucket, with a reference held
+    Bucket &find_or_claim(const std::string &client, int64_t now) {
+        uint64_t hash = hash_of(client);
+        // Another caller may take over the same idle bucket first: look again
+        for (size_t attempt = 0; attempt < MAX_TAKE_OVERS; ++attempt) {
+            Bucket *idlest = nullptr;
+            for (size_t probe = 0; probe < _max_probes; ++probe) {
+                Bucket &bucket = _buckets[(hash + probe) & (_capacity - 1)];
+                uint32_t state = bucket.state.load(std::memory_order_acquire);
+                if (state == EMPTY &&
+                    bucket.state.compare_exchange_strong(state, CLAIMING, std::memory_order_acquire))
+                    return assign(bucket, client, hash, now);
+                // Somebody else is claiming this bucket right now, possibly for us
+                while (state == CLAIMING) state = bucket.state.load(std::memory_order_acquire);
+                if (bucket.hash.load(std::memory_order_relaxed) == hash && hold_if_owner(bucket, client, hash)) return bucket;
+                if (!bucket.pinned &&
+                    (!idlest || bucket.tat.load(std::memory_order_relaxed) < idlest->tat.load(std::memory_order_relaxed)))
+                    idlest = &bucket;
+            }
+            // A bucket still over its limit is not taken over: resetting it
+            // would give its client a fresh burst
+            if (!idlest || idlest->tat.load(std::memory_order_relaxed) > now) break;
+            if (take_over(*idlest, now)) return assign(*idlest, client, hash, now);
+        }
+        _overflow.refs.fetch_add(1, std::memory_order_relaxed);
+        return _overflow;
+    }
+
+    RateLimiterOptions _options;
+    size_t _capacity;
+    std::unique_ptr<Bucket[]> _buckets;
+    size_t _max_probes;             // MAX_PROBES, or more if an override landed further away
+    Bucket _overflow;
+    std::atomic<uint64_t> _rejected{0};
+};
+
+#endif
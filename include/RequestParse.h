@@ -0,0 +1,58 @@
+#ifndef RequestParse_H
+#define RequestParse_H
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <httplib.h>
+
+
+// Allocation-free helpers for the request hot path. httplib already splits
+// the query into `req.params`, but every get_param_value() hands back a
+// fresh std::string; these read the raw request target instead.
+
+enum class ParamParse { Ok, Missing, Invalid };
+
+// Raw (still URL-encoded) value of query parameter `name` in `target`
+inline bool raw_query_param(std::string_view target, std::string_view name, std::string_view &value)
+{
+    size_t query = target.find('?');
+    if (query == std::string_view::npos) return false;
+    target.remove_prefix(query + 1);
+    while (!target.empty()) {
+        size_t amp = target.find('&');
+        std::string_view pair = target.substr(0, amp);
+        size_t eq = pair.find('=');
+        if (pair.substr(0, eq) == name) {
+            value = eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1);
+            return true;
+        }
+        if (amp == std::string_view::npos) break;
+        target.remove_prefix(amp + 1);
+    }
+    return false;
+}
+
+// Whole of `text` as a base-10 integer
+inline bool parse_integer(std::string_view text, long long &out)
+{
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+// Parse integer parameter `name`: straight from the request target with
+// from_chars, falling back to httplib's decoded copy only when the raw
+// value is URL-encoded or not in the query string at all.
+inline ParamParse parse_integer_param(const httplib::Request &req, std::string_view name, long long &out)
+{
+    std::string_view raw;
+    if (raw_query_param(req.target, name, raw) && raw.find_first_of("%+") == std::string_view::npos) {
+        if (raw.empty()) return ParamParse::Missing;
+        return parse_integer(raw, out) ? ParamParse::Ok : ParamParse::Invalid;
+    }
+    std::string decoded = req.get_param_value(std::string(name));
+    if (decoded.empty()) return ParamParse::Missing;
+    return parse_integer(decoded, out) ? ParamParse::Ok : ParamParse::Invalid;
+}
+
+#endif
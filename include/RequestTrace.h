@@ -0,0 +1,216 @@
+#ifndef RequestTrace_H
+#define RequestTrace_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sched.h>
+
+
+// Request traces: the server records every request it answers as a
+// fixed-size binary record, and the load generator replays them. A trace
+// file is a TraceFileHeader followed by TraceRecords, in host byte order.
+enum class TraceOp : uint8_t {
+    Get = 0,
+    Put = 1,
+    Delete = 2,
+    GetPopular = 3,
+    Scan = 4
+};
+
+struct TraceRecord {
+    uint64_t time_us ;      // arrival, since the trace was started
+    int64_t  key ;
+    uint32_t value_size ;   // put: bytes written; get: bytes returned (0 on a miss); scan: rows asked for
+    uint16_t status ;       // HTTP status of the response
+    uint8_t  op ;           // TraceOp
+    uint8_t  reserved ;
+};
+static_assert(sizeof(TraceRecord) == 24, "trace records are written as is");
+
+struct TraceFileHeader {
+    char     magic[8] ;     // TRACE_MAGIC
+    uint32_t version ;
+    uint32_t record_size ;  // sizeof(TraceRecord) of the writer
+};
+
+static const char TRACE_MAGIC[8] = {'K', 'V', 'T', 'R', 'A', 'C', 'E', '\0'};
+static const uint32_t TRACE_VERSION = 1;
+
+// Reads a whole trace and sorts it by arrival time (writers flush their
+// batches independently, so the file is only ordered within a batch).
+// Returns false, with `error` set, when the file is missing or not a trace.
+inline bool read_trace(const std::string &path, std::vector<TraceRecord> &records, std::string &error)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    TraceFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)) {
+        std::fclose(file);
+        error = path + " is not a version " + std::to_string(TRACE_VERSION) + " request trace";
+        return false;
+    }
+    TraceRecord chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, sizeof(TraceRecord), 4096, file)) > 0)
+        records.insert(records.end(), chunk, chunk + n);
+    std::fclose(file);
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord &a, const TraceRecord &b) { return a.time_us < b.time_us; });
+    return true;
+}
+
+
+// Appends request records to a trace file at a cost of one uncontended lock
+// and a 24-byte copy per request. Records go into per-CPU batches; a full
+// batch is handed to a background thread that writes it out, so request
+// threads never wait for the disk. If the writer falls more than
+// `max_pending` batches behind, further batches are dropped (and counted)
+// rather than letting memory grow.
+class TraceRecorder {
+public:
+    static const size_t BATCH_RECORDS = 4096;
+
+    TraceRecorder() = default;
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    ~TraceRecorder() { Stop(); }
+
+    // Starts recording to `path` (truncated). Returns false when it cannot be written.
+    bool Start(const std::string &path, size_t max_pending = 64) {
+        if (_file) return false;
+        _file = std::fopen(path.c_str(), "wb");
+        if (!_file) return false;
+        TraceFileHeader header;
+        std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        header.version = TRACE_VERSION;
+        header.record_size = sizeof(TraceRecord);
+        std::fwrite(&header, sizeof(header), 1, _file);
+
+        _max_pending = std::max<size_t>(1, max_pending);
+        _stripes = std::vector<Stripe>(std::max(1u, std::thread::hardware_concurrency()));
+        for (auto &stripe : _stripes) stripe.batch.reserve(BATCH_RECORDS);
+        _stop = false;
+        _start = std::chrono::steady_clock::now();
+        _writer = std::thread(&TraceRecorder::write_loop, this);
+        _enabled.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Flushes what is buffered, waits for the writer and closes the file
+    void Stop() {
+        if (!_enabled.exchange(false)) return;
+        for (auto &stripe : _stripes) {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            if (!stripe.batch.empty()) hand_off(stripe.batch);
+        }
+        {
+            std::lock_guard<std::mutex> lock(_queue_mutex);
+            _stop = true;
+        }
+        _queue_cv.notify_one();
+        _writer.join();
+        std::fclose(_file);
+        _file = nullptr;
+    }
+
+    bool Enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    void Record(std::chrono::steady_clock::time_point arrival, TraceOp op, long long key, size_t value_size, int status) {
+        if (!Enabled()) return;
+        TraceRecord record;
+        auto since = arrival > _start ? arrival - _start : std::chrono::steady_clock::duration::zero();
+        record.time_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(since).count());
+        record.key = key;
+        record.value_size = static_cast<uint32_t>(std::min<size_t>(value_size, UINT32_MAX));
+        record.status = static_cast<uint16_t>(status);
+        record.op = static_cast<uint8_t>(op);
+        record.reserved = 0;
+
+        int cpu = sched_getcpu();
+        Stripe &stripe = _stripes[(cpu < 0 ? 0 : static_cast<size_t>(cpu)) % _stripes.size()];
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        stripe.batch.push_back(record);
+        if (stripe.batch.size() >= BATCH_RECORDS) hand_off(stripe.batch);
+    }
+
+    uint64_t Written() const { return _written.load(std::memory_order_relaxed); }
+    uint64_t Dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+        std::vector<TraceRecord> batch;
+    };
+
+    // Queues a full batch for the writer and leaves `batch` empty (reusing a
+    // written buffer when there is one). Called with the stripe lock held.
+    void hand_off(std::vector<TraceRecord> &batch) {
+        std::vector<TraceRecord> next;
+        {
+            std::lock_guard<std::mutex> lock(_queue_mutex);
+            if (_pending.size() >= _max_pending) {
+                _dropped.fetch_add(batch.size(), std::memory_order_relaxed);
+                batch.clear();
+                return;
+            }
+            _pending.push_back(std::move(batch));
+            if (!_spare.empty()) {
+                next = std::move(_spare.back());
+                _spare.pop_back();
+            }
+        }
+        _queue_cv.notify_one();
+        next.reserve(BATCH_RECORDS);
+        batch = std::move(next);
+    }
+
+    void write_loop() {
+        std::unique_lock<std::mutex> lock(_queue_mutex);
+        for (;;) {
+            _queue_cv.wait(lock, [this] { return _stop || !_pending.empty(); });
+            if (_pending.empty()) return;   // stopping and everything is written
+            std::vector<std::vector<TraceRecord>> batches;
+            batches.swap(_pending);
+            lock.unlock();
+            for (auto &batch : batches) {
+                _written.fetch_add(std::fwrite(batch.data(), sizeof(TraceRecord), batch.size(), _file),
+                                   std::memory_order_relaxed);
+                batch.clear();
+            }
+            lock.lock();
+            for (auto &batch : batches)
+                if (_spare.size() < _max_pending) _spare.push_back(std::move(batch));
+        }
+    }
+
+    std::atomic<bool> _enabled{false};
+    std::chrono::steady_clock::time_point _start;
+    FILE *_file = nullptr;
+    std::vector<Stripe> _stripes;
+
+    std::mutex _queue_mutex;
+    std::condition_variable _queue_cv;
+    std::vector<std::vector<TraceRecord>> _pending;     // full batches, oldest first
+    std::vector<std::vector<TraceRecord>> _spare;       // written buffers for reuse
+    size_t _max_pending = 64;
+    bool _stop = false;
+    std::thread _writer;
+
+    std::atomic<uint64_t> _written{0};
+    std::atomic<uint64_t> _dropped{0};
+};
+
+#endif
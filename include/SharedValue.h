@@ -0,0 +1,111 @@
+#ifndef SharedValue_H
+#define SharedValue_H
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <Numa.h>
+
+// Immutable, reference-counted byte buffer. The bytes are copied once, when
+// the value is created, into a block that carries its own reference count;
+// copying a SharedValue afterwards only bumps that count. The cache stores
+// values this way so that a lookup holds the shard lock for a pointer copy
+// instead of a copy of the whole value, and the block is freed by whichever
+// handle lets go of it last (possibly long after it left the cache).
+//
+// The last reference may be dropped on any thread, outside any shard lock,
+// so blocks never come from a shard's own NumaArena. They come either from
+// the global heap or from a thread-safe SharedNumaArena, which the block
+// remembers so it is freed back to the same place.
+class SharedValue {
+public:
+    SharedValue() = default;
+
+    SharedValue(const char *data, size_t size) : SharedValue(data, size, nullptr) {}
+
+    // The block is taken from `arena` (nullptr = global heap)
+    SharedValue(const char *data, size_t size, SharedNumaArena *arena) {
+        if (size == 0) return;
+        void *raw = arena ? arena->Allocate(sizeof(Block) + size) : ::operator new(sizeof(Block) + size);
+        _block = new (raw) Block{{1}, size, arena};
+        std::memcpy(_block->bytes(), data, size);
+    }
+
+    explicit SharedValue(std::string_view bytes) : SharedValue(bytes.data(), bytes.size()) {}
+
+    SharedValue(const SharedValue &other) noexcept : _block(other._block) {
+        if (_block) _block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    SharedValue(SharedValue &&other) noexcept : _block(other._block) { other._block = nullptr; }
+
+    SharedValue &operator=(const SharedValue &other) noexcept {
+        SharedValue copy(other);
+        swap(copy);
+        return *this;
+    }
+
+    SharedValue &operator=(SharedValue &&other) noexcept {
+        SharedValue moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    ~SharedValue() { release(); }
+
+    void swap(SharedValue &other) noexcept { std::swap(_block, other._block); }
+
+    const char *data() const        { return _block ? _block->bytes() : "" ; }
+    size_t size() const             { return _block ? _block->size : 0 ; }
+    bool empty() const              { return size() == 0 ; }
+    std::string_view view() const   { return std::string_view(data(), size()) ; }
+    operator std::string_view() const { return view() ; }
+    std::string str() const         { return std::string(data(), size()) ; }
+
+    // Same buffer, not merely equal bytes: tells whether a cache entry was
+    // replaced since this handle was taken from it
+    bool SharesBuffer(const SharedValue &other) const { return _block == other._block; }
+
+    // Handles sharing this buffer (0 for an empty value)
+    uint32_t UseCount() const { return _block ? _block->refs.load(std::memory_order_relaxed) : 0; }
+
+    bool operator==(const SharedValue &other) const { return view() == other.view(); }
+    bool operator!=(const SharedValue &other) const { return !(*this == other); }
+
+private:
+    struct Block {
+        std::atomic<uint32_t> refs;
+        size_t size;
+        SharedNumaArena *arena;     // where the block goes back to, nullptr = global heap
+        char *bytes() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    void release() noexcept {
+        if (!_block) return;
+        // acq_rel: the thread freeing the block must see every other
+        // handle's reads of it as finished
+        if (_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            SharedNumaArena *arena = _block->arena;
+            size_t bytes = sizeof(Block) + _block->size;
+            _block->~Block();
+            if (arena) arena->Deallocate(_block, bytes);
+            else ::operator delete(_block);
+        }
+        _block = nullptr;
+    }
+
+    Block *_block = nullptr;
+};
+
+inline std::ostream &operator<<(std::ostream &out, const SharedValue &value)
+{
+    return out << value.view();
+}
+
+#endif
@@ -0,0 +1,405 @@
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <new>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+
+// Minimal futex wrappers: block while *word == expected (optionally for at
+// most the relative `timeout`) / wake waiters.
+inline void futex_wait(std::atomic<uint32_t> *word, uint32_t expected, const struct timespec *timeout = nullptr)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t> *word, int count)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+
+// Move-only `void()` callable with inline storage. Callables up to
+// INLINE_BYTES (every lambda the server submits) are stored in place, so
+// queuing a task never allocates; larger ones fall back to the heap.
+class Task {
+public:
+    static constexpr size_t INLINE_BYTES = 48;
+
+    Task() = default;
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f) {
+        using Fn = typename std::decay<F>::type;
+        if (sizeof(Fn) <= INLINE_BYTES && alignof(Fn) <= alignof(std::max_align_t)) {
+            new (&_storage) Fn(std::forward<F>(f));
+            _ops = &inline_ops<Fn>;
+        } else {
+            *reinterpret_cast<Fn**>(&_storage) = new Fn(std::forward<F>(f));
+            _ops = &heap_ops<Fn>;
+        }
+    }
+
+    Task(Task&& other) noexcept { move_from(other); }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    explicit operator bool() const { return _ops != nullptr; }
+    void operator()() { _ops->invoke(&_storage); }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src);     // move-construct dst from src, destroy src
+        void (*destroy)(void*);
+    };
+
+    template <typename Fn>
+    static constexpr Ops inline_ops = {
+        [](void* p) { (*static_cast<Fn*>(p))(); },
+        [](void* dst, void* src) { new (dst) Fn(std::move(*static_cast<Fn*>(src))); static_cast<Fn*>(src)->~Fn(); },
+        [](void* p) { static_cast<Fn*>(p)->~Fn(); },
+    };
+
+    template <typename Fn>
+    static constexpr Ops heap_ops = {
+        [](void* p) { (**static_cast<Fn**>(p))(); },
+        [](void* dst, void* src) { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); },
+        [](void* p) { delete *static_cast<Fn**>(p); },
+    };
+
+    void move_from(Task& other) {
+        _ops = other._ops;
+        if (_ops) _ops->move(&_storage, &other._storage);
+        other._ops = nullptr;
+    }
+
+    void reset() {
+        if (_ops) _ops->destroy(&_storage);
+        _ops = nullptr;
+    }
+
+    typename std::aligned_storage<INLINE_BYTES, alignof(std::max_align_t)>::type _storage;
+    const Ops *_ops = nullptr;
+};
+
+
+// Bounded lock-free multi-producer / multi-consumer ring (Vyukov). Each
+// cell carries a sequence number that tells producers and consumers whose
+// turn it is, so the only shared writes are one CAS per push or pop.
+class TaskRing {
+public:
+    explicit TaskRing(size_t capacity_pow2)
+        : _mask(capacity_pow2 - 1), _cells(new Cell[capacity_pow2])
+    {
+        for (size_t i = 0; i < capacity_pow2; ++i)
+            _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool TryPush(Task &task) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[pos & _mask];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.task = std::move(task);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;                       // full
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(Task &task) {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[pos & _mask];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    task = std::move(cell.task);
+                    cell.seq.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;                       // empty
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate number of queued tasks
+    size_t Size() const {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        Task task;
+    };
+
+    const size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+    alignas(64) std::atomic<size_t> _head{0};
+    alignas(64) std::atomic<size_t> _tail{0};
+};
+
+
+// Fixed-size worker pool. Every worker owns a lock-free ring; submitters
+// spread tasks over the rings and idle workers steal from their peers
+// before parking on a futex. run() blocks the caller on a stack-allocated
+// completion, so a round trip through the pool performs no heap allocation.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t n, size_t ring_capacity = 1024) {
+        if (n == 0) n = 1;
+        size_t capacity = 1;
+        while (capacity < ring_capacity) capacity <<= 1;
+        for (size_t i = 0; i < n; ++i)
+            _rings.push_back(std::make_unique<PaddedRing>(capacity));
+        for (size_t i = 0; i < n; ++i)
+            _workers.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~ThreadPool() {
+        _stop.store(true, std::memory_order_seq_cst);
+        _epoch.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(&_epoch, INT_MAX);
+        for (auto &t : _workers) if (t.joinable()) t.join();
+        // A task pushed while the workers were exiting would leave its
+        // run() caller waiting forever: run what is left here
+        drain();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Run `f` on the pool and wait for its result (exceptions are rethrown)
+    template <typename F>
+    auto run(F&& f) -> decltype(f()) {
+        using R = decltype(f());
+        typename std::conditional<std::is_void<R>::value, VoidCompletion<R>, Completion<R>>::type done;
+        enqueue(Task([&done, &f]() { done.complete(f); }));
+        return done.wait();
+    }
+
+    // Fire-and-forget variant of run(); exceptions are swallowed
+    template <typename F>
+    void post(F&& f) {
+        enqueue(Task([fn = std::forward<F>(f)]() mutable {
+            try { fn(); } catch (...) { /* ignore task exceptions */ }
+        }));
+    }
+
+    // Submit a task and get a future (allocates the shared state; prefer run())
+    template <typename F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        using R = decltype(f());
+        auto task_ptr = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> fut = task_ptr->get_future();
+        enqueue(Task([task_ptr]() { (*task_ptr)(); }));
+        return fut;
+    }
+
+    size_t Size() const { return _workers.size(); }
+
+    // Approximate number of tasks waiting for a worker
+    size_t QueueDepth() const {
+        size_t depth = _overflow_size.load(std::memory_order_relaxed);
+        for (auto &ring : _rings) depth += ring->Size();
+        return depth;
+    }
+
+private:
+    struct alignas(64) PaddedRing : TaskRing {
+        explicit PaddedRing(size_t capacity) : TaskRing(capacity) {}
+    };
+
+    // Result slot living on the waiting caller's stack
+    template <typename R>
+    struct Completion {
+        std::atomic<uint32_t> state{0};
+        typename std::aligned_storage<sizeof(R), alignof(R)>::type value;
+        std::exception_ptr error;
+
+        template <typename F>
+        void complete(F &f) {
+            try { new (&value) R(f()); } catch (...) { error = std::current_exception(); }
+            // The waiter may return (and this object go away) as soon as it
+            // sees the flag; a wake on the stale address is harmless.
+            state.store(1, std::memory_order_release);
+            futex_wake(&state, 1);
+        }
+
+        R wait() {
+            while (state.load(std::memory_order_acquire) == 0) futex_wait(&state, 0);
+            if (error) std::rethrow_exception(error);
+            R *result = reinterpret_cast<R*>(&value);
+            R out(std::move(*result));
+            result->~R();
+            return out;
+        }
+    };
+
+    template <typename Unused>
+    struct VoidCompletion {
+        std::atomic<uint32_t> state{0};
+        std::exception_ptr error;
+
+        template <typename F>
+        void complete(F &f) {
+            try { f(); } catch (...) { error = std::current_exception(); }
+            // The waiter may return (and this object go away) as soon as it
+            // sees the flag; a wake on the stale address is harmless.
+            state.store(1, std::memory_order_release);
+            futex_wake(&state, 1);
+        }
+
+        void wait() {
+            while (state.load(std::memory_order_acquire) == 0) futex_wait(&state, 0);
+            if (error) std::rethrow_exception(error);
+        }
+    };
+
+    void enqueue(Task task) {
+        if (_stop.load(std::memory_order_relaxed)) throw std::runtime_error("ThreadPool stopped");
+
+        // Each submitting thread walks the rings round-robin from its own
+        // offset and takes the shorter of two candidates, which keeps queue
+        // lengths (and so the wait behind a busy worker) even.
+        thread_local size_t next = static_cast<size_t>(reinterpret_cast<uintptr_t>(&next) >> 6);
+        size_t n = _rings.size();
+        size_t start = next++ % n;
+        size_t other = (start + n / 2) % n;
+        if (_rings[other]->Size() < _rings[start]->Size()) start = other;
+        bool queued = false;
+        for (size_t i = 0; i < n && !queued; ++i)
+            queued = _rings[(start + i) % n]->TryPush(task);
+        if (!queued) {
+            std::lock_guard<std::mutex> lock(_overflow_mutex);
+            _overflow.push_back(std::move(task));
+            _overflow_size.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Pairs with the sleeper registration in worker_loop(): either we see
+        // the sleeper, or the sleeper's re-check sees our task.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Stopped while we pushed: the workers may be gone, and the
+        // destructor may have drained before our task was there
+        if (_stop.load(std::memory_order_seq_cst)) {
+            drain();
+            return;
+        }
+        if (_sleepers.load(std::memory_order_relaxed) > 0) {
+            _epoch.fetch_add(1, std::memory_order_release);
+            futex_wake(&_epoch, 1);
+        }
+    }
+
+    bool try_take(size_t self, Task &task) {
+        size_t n = _rings.size();
+        for (size_t i = 0; i < n; ++i)              // own ring first, then steal
+            if (_rings[(self + i) % n]->TryPop(task)) return true;
+        if (_overflow_size.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(_overflow_mutex);
+            if (!_overflow.empty()) {
+                task = std::move(_overflow.front());
+                _overflow.pop_front();
+                _overflow_size.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs queued tasks on the calling thread, once the pool is stopped
+    void drain() {
+        // Pairs with the fence in enqueue(): a push whose _stop check missed
+        // the stop is visible here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Task task;
+        while (try_take(0, task)) {
+            task();
+            task = Task();
+        }
+    }
+
+    void worker_loop(size_t self) {
+        Task task;
+        for (;;) {
+            bool found = try_take(self, task);
+            // Spin briefly before parking: DB tasks tend to arrive in bursts
+            for (int spin = 0; !found && spin < 64; ++spin) {
+                std::this_thread::yield();
+                found = try_take(self, task);
+            }
+            if (!found) {
+                uint32_t epoch = _epoch.load(std::memory_order_acquire);
+                _sleepers.fetch_add(1, std::memory_order_seq_cst);
+                found = try_take(self, task);
+                if (!found) {
+                    if (_stop.load(std::memory_order_seq_cst)) {
+                        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+                        return;                      // stopped and drained
+                    }
+                    futex_wait(&_epoch, epoch);
+                }
+                _sleepers.fetch_sub(1, std::memory_order_relaxed);
+                if (!found) continue;
+            }
+            task();
+            task = Task();
+        }
+    }
+
+    std::vector<std::unique_ptr<PaddedRing>> _rings;
+    std::vector<std::thread> _workers;
+
+    std::mutex _overflow_mutex;                     // only used when every ring is full
+    std::deque<Task> _overflow;
+    std::atomic<size_t> _overflow_size{0};
+
+    alignas(64) std::atomic<uint32_t> _epoch{0};    // bumped to wake parked workers
+    alignas(64) std::atomic<int> _sleepers{0};
+    std::atomic<bool> _stop{false};
+};
+
+#endif
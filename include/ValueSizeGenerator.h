@@ -0,0 +1,125 @@
+#ifndef ValueSizeGenerator_H
+#define ValueSizeGenerator_H
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+#include <KeyGenerator.h>
+
+
+// Value size models for the load generator's writes
+enum class ValueSizeDistribution {
+    Fixed,          // every value has `size` bytes
+    Uniform,        // sizes equally likely in [min, max]
+    Zipfian,        // size min + r has popularity ~ 1/(r+1)^theta: small values dominate
+    Histogram       // sizes drawn from a weighted list of (size, weight) buckets
+};
+
+struct ValueSizeOptions {
+    ValueSizeDistribution kind = ValueSizeDistribution::Fixed ;
+    size_t size = 32 ;              // fixed
+    size_t min = 1 ;                // uniform, zipfian
+    size_t max = 512 ;              // uniform, zipfian (the kv schema holds up to 512 bytes)
+    double theta = 0.99 ;           // zipfian skew, 0 < theta < 1
+    std::vector<std::pair<size_t, double>> histogram ;     // (size, weight)
+};
+
+inline ValueSizeDistribution parse_value_size_distribution(const std::string &name)
+{
+    if (name == "fixed") return ValueSizeDistribution::Fixed;
+    if (name == "uniform") return ValueSizeDistribution::Uniform;
+    if (name == "zipfian") return ValueSizeDistribution::Zipfian;
+    if (name == "histogram") return ValueSizeDistribution::Histogram;
+    throw std::invalid_argument("Invalid value size distribution: " + name +
+                                " (expected fixed, uniform, zipfian or histogram)");
+}
+
+inline const char *value_size_distribution_name(ValueSizeDistribution kind)
+{
+    switch (kind) {
+        case ValueSizeDistribution::Fixed:     return "fixed";
+        case ValueSizeDistribution::Uniform:   return "uniform";
+        case ValueSizeDistribution::Zipfian:   return "zipfian";
+        case ValueSizeDistribution::Histogram: return "histogram";
+    }
+    return "unknown";
+}
+
+// "size:weight,size:weight,..." -> histogram buckets, e.g. "32:0.6,128:0.3,512:0.1"
+inline std::vector<std::pair<size_t, double>> parse_value_size_histogram(const std::string &spec)
+{
+    std::vector<std::pair<size_t, double>> buckets;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) throw std::invalid_argument("Histogram bucket must be size:weight, got " + item);
+        buckets.emplace_back(std::stoul(item.substr(0, colon)), std::stod(item.substr(colon + 1)));
+    }
+    return buckets;
+}
+
+
+// Per-thread value size source, like KeyGenerator: threads only share the
+// read-only Zipfian constants (built over max - min + 1 sizes).
+class ValueSizeGenerator {
+public:
+    ValueSizeGenerator(const ValueSizeOptions &options, const ZipfianParams *zipfian, uint64_t seed)
+        : _options(options), _zipfian(zipfian), _rng(seed)
+    {
+        switch (options.kind) {
+            case ValueSizeDistribution::Fixed:
+                if (options.size < 1) throw std::invalid_argument("Value size must be positive");
+                break;
+            case ValueSizeDistribution::Uniform:
+            case ValueSizeDistribution::Zipfian:
+                if (options.min < 1 || options.max < options.min)
+                    throw std::invalid_argument("Value sizes need 1 <= min <= max");
+                if (options.kind == ValueSizeDistribution::Zipfian &&
+                    (!zipfian || zipfian->Items() != static_cast<long long>(options.max - options.min + 1)))
+                    throw std::invalid_argument("Zipfian constants missing or built for another size range");
+                break;
+            case ValueSizeDistribution::Histogram: {
+                std::vector<double> weights;
+                double total = 0;
+                for (auto &bucket : options.histogram) {
+                    if (bucket.first < 1 || !(bucket.second >= 0))
+                        throw std::invalid_argument("Histogram sizes must be positive and weights non-negative");
+                    weights.push_back(bucket.second);
+                    total += bucket.second;
+                }
+                if (!(total > 0)) throw std::invalid_argument("Histogram needs a bucket with a positive weight");
+                _buckets = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+                break;
+            }
+        }
+    }
+
+    // Size in bytes of the next value
+    size_t Next() {
+        switch (_options.kind) {
+            case ValueSizeDistribution::Fixed:
+                return _options.size;
+            case ValueSizeDistribution::Uniform:
+                return std::uniform_int_distribution<size_t>(_options.min, _options.max)(_rng);
+            case ValueSizeDistribution::Zipfian:
+                return _options.min + static_cast<size_t>(_zipfian->Rank(std::uniform_real_distribution<double>(0.0, 1.0)(_rng)));
+            case ValueSizeDistribution::Histogram:
+                return _options.histogram[_buckets(_rng)].first;
+        }
+        return _options.size;
+    }
+
+private:
+    ValueSizeOptions _options;
+    const ZipfianParams *_zipfian;
+    std::mt19937_64 _rng;
+    std::discrete_distribution<size_t> _buckets;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef YcsbWorkload_H
+#define YcsbWorkload_H
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+
+#include <KeyGenerator.h>
+
+
+// Operation mix of a YCSB core workload (Cooper et al., "Benchmarking Cloud
+// Serving Systems with YCSB"). Proportions need not add up to 1; they are
+// normalised when an operation is drawn.
+struct YcsbWorkload {
+    char name = 'A' ;
+    double read = 0 ;
+    double update = 0 ;
+    double insert = 0 ;
+    double scan = 0 ;
+    double read_modify_write = 0 ;
+    KeyDistribution request_distribution = KeyDistribution::Zipfian ;
+    long long record_count = 10000 ;    // keys written by the load phase
+    int max_scan_length = 100 ;         // scan lengths are uniform in [1, max]
+    size_t field_length = 100 ;         // value size in bytes
+
+    double Total() const { return read + update + insert + scan + read_modify_write ; }
+};
+
+// The six core workloads with their published default mixes
+inline YcsbWorkload ycsb_preset(char letter)
+{
+    YcsbWorkload w;
+    w.name = letter;
+    switch (letter) {
+        case 'A': w.read = 0.5;  w.update = 0.5; break;                     // update heavy (session store)
+        case 'B': w.read = 0.95; w.update = 0.05; break;                    // read mostly (photo tagging)
+        case 'C': w.read = 1.0; break;                                      // read only (profile cache)
+        case 'D': w.read = 0.95; w.insert = 0.05;                           // read latest (status updates)
+                  w.request_distribution = KeyDistribution::Latest; break;
+        case 'E': w.scan = 0.95; w.insert = 0.05; break;                    // short ranges (threaded conversations)
+        case 'F': w.read = 0.5;  w.read_modify_write = 0.5; break;          // read-modify-write (user database)
+        default:
+            throw std::invalid_argument(std::string("Invalid YCSB workload: ") + letter + " (expected A-F)");
+    }
+    return w;
+}
+
+#endif
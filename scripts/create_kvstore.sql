@@ -6,13 +6,26 @@ USE kvstore;
 
 -- Create the key-value table
 CREATE TABLE IF NOT EXISTS kv (
-    k VARCHAR(64) PRIMARY KEY,      -- Key (string, unique)
-    value VARCHAR(512) NOT NULL     -- Value (string payload, up to 512 chars)
+    k BIGINT PRIMARY KEY,           -- Key (integer, unique; /scan returns keys in this order)
+    value VARCHAR(512) NOT NULL,    -- Value (string payload, up to 512 chars)
+    updated_at TIMESTAMP(6) NOT NULL DEFAULT CURRENT_TIMESTAMP(6)
+               ON UPDATE CURRENT_TIMESTAMP(6)   -- Last write, used by the startup cache warm-up
 );
 
 -- Optional: Index on value (for faster searches, if ever needed)
 CREATE INDEX idx_value ON kv(value);
 
+-- Index used by the server to stream the most recently written keys at startup
+CREATE INDEX idx_updated_at ON kv(updated_at);
+
+-- For a table created before updated_at existed, run instead:
+-- ALTER TABLE kv ADD COLUMN updated_at TIMESTAMP(6) NOT NULL DEFAULT CURRENT_TIMESTAMP(6) ON UPDATE CURRENT_TIMESTAMP(6),
+--               ADD INDEX idx_updated_at (updated_at);
+
+-- For a table created with k VARCHAR(64), convert the key before using /scan
+-- (the server refuses scans on it: strings sort "10" before "9"):
+-- ALTER TABLE kv MODIFY k BIGINT NOT NULL;
+
 -- Verify structure
 DESCRIBE kv;
 
@@ -11,12 +11,16 @@ SERVER_BIN="../build/server"                 # Path to your compiled server
 # export DB_PASS="#YourPassword"
 # export DB_HOST="localhost"
 # export DB_NAME="kvstore"
+# Or benchmark without a database: export KV_STORE=mock (see KV_MOCK_* in the README)
 
 EXPERIMENT_DURATION_SEC=120 # 5 minutes per run (metrics collection duration)
 WARMUP_TIME_SEC=10          # Time to let server stabilize before collecting client metrics
 SLEEP_BETWEEN_RUNS=10       # Seconds to wait between starting server and load generator
 LOG_INTERVAL=5              # Log metrics every 5 seconds
 
+# Cache snapshot used to warm-restart the server between runs (empty = always start cold)
+SNAPSHOT_PATH=""
+
 # --- CPU Affinity Settings ---
 # Adjust these cores based on your specific hardware (use 'lscpu' to check)
 SERVER_CPU_CORE=19 # Server process pinned to this single core
@@ -72,7 +76,8 @@ setup_environment() {
     mkdir -p "$CLIENT_LOG_DIR" "$SERVER_LOG_DIR" "$ANALYSIS_LOG_DIR"
     echo "Logs will be stored in $LOG_DIR"
     
-    if [[ -z "$DB_USER" || -z "$DB_PASS" || -z "$DB_HOST" || -z "$DB_NAME" ]]; then
+    # KV_STORE=mock runs the server on its in-memory store, without MySQL
+    if [[ "$KV_STORE" != "mock" && ( -z "$DB_USER" || -z "$DB_PASS" || -z "$DB_HOST" || -z "$DB_NAME" ) ]]; then
         echo "ERROR: Database environment variables (DB_USER, DB_PASS, DB_HOST, DB_NAME) must be set."
         echo "Example: export DB_USER=\"kvuser\"; export DB_PASS=\"password\"..."
         exit 1
@@ -92,7 +97,7 @@ setup_environment() {
 start_server() {
     echo "Starting server on CPU Core $SERVER_CPU_CORE..."
     # Launch server in background with DB credentials and CPU affinity, redirecting its output to a log file
-    DB_USER=$DB_USER DB_PASS=$DB_PASS DB_HOST=$DB_HOST DB_NAME=$DB_NAME \
+    DB_USER=$DB_USER DB_PASS=$DB_PASS DB_HOST=$DB_HOST DB_NAME=$DB_NAME KV_SNAPSHOT_PATH=$SNAPSHOT_PATH \
     $SERVER_TASKSET_CMD "$SERVER_BIN" > "${SERVER_LOG_DIR}/server_output_${workload_type}_${threads}threads.log" 2>&1 &
     SERVER_PID=$!
     echo "Server started with PID: $SERVER_PID"
@@ -240,8 +245,11 @@ run_experiment() {
     CLIENT_OUTPUT_FILE="${CLIENT_LOG_DIR}/client_metrics_${workload_type}_${threads}threads.log"
     
     # Run client in background and capture its PID. 
-    # Note: Passing total_client_duration so it runs during warmup too.
-    $taskset_client_cmd "$LOAD_GENERATOR_BIN" "$threads" "$total_client_duration" "$workload_type" "http://${SERVER_HOST}:${SERVER_PORT}" > "$CLIENT_OUTPUT_FILE" 2>&1 &
+    # Note: Passing total_client_duration so it runs during warmup too; the
+    # warm-up is left out of the summary and marked in the per-second time series.
+    CLIENT_TIMESERIES_FILE="${CLIENT_LOG_DIR}/timeseries_${workload_type}_${threads}threads.csv"
+    $taskset_client_cmd "$LOAD_GENERATOR_BIN" "$threads" "$total_client_duration" "$workload_type" "http://${SERVER_HOST}:${SERVER_PORT}" \
+        --warmup="$WARMUP_TIME_SEC" --interval=1 --timeseries="$CLIENT_TIMESERIES_FILE" > "$CLIENT_OUTPUT_FILE" 2>&1 &
     CLIENT_PID=$!
     echo "Client started with PID: $CLIENT_PID"
 
@@ -267,6 +275,9 @@ run_experiment() {
 
     # 6. Extract and calculate average resource metrics
     calculate_average_metrics "$workload_type" "$threads"
+
+    # Keep the server's own counters (request/DB latency histograms, cache hits) for this run
+    curl -s "http://${SERVER_HOST}:${SERVER_PORT}/metrics" > "${SERVER_LOG_DIR}/metrics_${workload_type}_${threads}threads.prom" 2>/dev/null
     
     # 7. Stop the server and any remaining processes
     stop_processes
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <httplib.h>
+#include <LRUCache.h>
+#include <RequestParse.h>
+
+// Heap allocations per request on the cache-hit path of GET, counted in a
+// real httplib server over loopback:
+//
+//   ./alloc_bench [requests] [value_bytes]
+//
+//   legacy : the previous handler (get_param_value + stoll + a local value
+//            string + set_content)
+//   fast   : the current handler (from_chars on the request target, value
+//            copied from the cache straight into the response body)
+//   floor  : a handler that only copies a fixed value of the same size into
+//            the body, i.e. httplib's own per-request allocations (request
+//            parsing, response headers) plus the response body itself
+//
+// The client uses raw sockets and stack buffers, so every allocation
+// counted happens on the server side. fast - floor is what the hit path
+// allocates on top of the response it has to produce.
+
+static std::atomic<uint64_t> allocations{0} ;
+
+// Counting replacement of the global allocation functions (the matching
+// deletes are below; GCC cannot see that they pair up)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(size_t n)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed) ;
+    if (void *p = std::malloc(n ? n : 1)) return p ;
+    throw std::bad_alloc() ;
+}
+void operator delete(void *p) noexcept                  { std::free(p) ; }
+void operator delete(void *p, size_t) noexcept          { std::free(p) ; }
+
+const long long KEY_SPACE = 1000 ;
+
+static int connect_to(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0) ;
+    sockaddr_in addr ;
+    std::memset(&addr, 0, sizeof(addr)) ;
+    addr.sin_family = AF_INET ;
+    addr.sin_port = htons(port) ;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK) ;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return -1 ;
+    int one = 1 ;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) ;
+    return fd ;
+}
+
+// One keep-alive GET; returns false on a non-200 response
+static bool request(int fd, long long key)
+{
+    char buf[16384] ;
+    int len = snprintf(buf, sizeof(buf), "GET /get?key=%lld HTTP/1.1\r\nHost: localhost\r\n\r\n", key) ;
+    if (send(fd, buf, len, 0) != len) return false ;
+
+    size_t got = 0 ;
+    const char *body = nullptr ;
+    while (!body) {
+        ssize_t n = recv(fd, buf + got, sizeof(buf) - 1 - got, 0) ;
+        if (n <= 0) return false ;
+        got += n ;
+        buf[got] = '\0' ;
+        if (const char *end = std::strstr(buf, "\r\n\r\n")) body = end + 4 ;
+    }
+    bool ok = std::strncmp(buf, "HTTP/1.1 200", 12) == 0 ;
+    const char *cl = strcasestr(buf, "Content-Length:") ;
+    size_t content_length = cl ? std::strtoul(cl + 15, nullptr, 10) : 0 ;
+    size_t have = got - (body - buf) ;
+    while (have < content_length) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0) ;
+        if (n <= 0) return false ;
+        have += n ;
+    }
+    return ok ;
+}
+
+int main(int argc, char* argv[])
+{
+    int requests = 20000 ;
+    size_t value_bytes = 100 ;
+    if (argc >= 2) requests = std::stoi(argv[1]) ;
+    if (argc >= 3) value_bytes = std::stoul(argv[2]) ;
+    if (requests <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [requests] [value_bytes]" << std::endl ;
+        return 1 ;
+    }
+
+    ShardedLRUCache cache(2 * KEY_SPACE, 0) ;
+    for (long long key = 0; key < KEY_SPACE; ++key) cache.Put(key, std::string(value_bytes, 'v')) ;
+
+    httplib::Server server ;
+    // One keep-alive connection per handler for the whole run
+    server.set_keep_alive_max_count(3 * requests + 3000) ;
+    server.set_keep_alive_timeout(60) ;
+    // Headers and body go out in separate writes; don't let Nagle hold the body back
+    server.set_tcp_nodelay(true) ;
+    // All three handlers sit behind the same route: httplib's route matching
+    // allocates per route tried, so separate routes would skew the counts
+    enum Mode { LEGACY, FAST, FLOOR } ;
+    std::atomic<int> mode{LEGACY} ;
+    const std::string fixed(value_bytes, 'v') ;
+
+    server.Get("/get", [&](const httplib::Request &req, httplib::Response &res) {
+        if (mode == LEGACY) {
+            std::string key_param = req.get_param_value("key") ;
+            if (key_param.empty()) { res.status = 400 ; return ; }
+            long long key = 0 ;
+            try { key = std::stoll(key_param) ; } catch (const std::exception &) { res.status = 400 ; return ; }
+            std::string value ;
+            if (cache.Lookup(key, value) != CacheLookup::Hit) { res.status = 404 ; return ; }
+            res.status = 200 ;
+            res.set_content(value, "text/plain") ;
+        } else if (mode == FAST) {
+            long long key = 0 ;
+            if (parse_integer_param(req, "key", key) != ParamParse::Ok) { res.status = 400 ; return ; }
+            if (cache.Lookup(key, res.body) != CacheLookup::Hit) { res.status = 404 ; return ; }
+            res.status = 200 ;
+        } else {
+            res.body = fixed ;
+            res.status = 200 ;
+        }
+    }) ;
+
+    int port = server.bind_to_any_port("127.0.0.1") ;
+    std::thread listener([&] { server.listen_after_bind() ; }) ;
+    server.wait_until_ready() ;
+
+    std::cout << "requests: " << requests << ", value: " << value_bytes << " bytes" << std::endl ;
+    const char *names[] = {"legacy", "fast", "floor"} ;
+    for (int m : {LEGACY, FAST, FLOOR}) {
+        mode = m ;
+        int fd = connect_to(port) ;
+        if (fd < 0) { std::cerr << "connect failed" << std::endl ; return 1 ; }
+        // Warm up: worker thread, allocator caches
+        for (int i = 0; i < 1000; ++i) request(fd, i % KEY_SPACE) ;
+
+        uint64_t before = allocations.load() ;
+        int ok = 0 ;
+        for (int i = 0; i < requests; ++i) ok += request(fd, i % KEY_SPACE) ;
+        uint64_t after = allocations.load() ;
+        close(fd) ;
+
+        std::cout << std::left << std::setw(10) << names[m] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << static_cast<double>(after - before) / requests << " allocations/request"
+                  << "   (" << ok << " OK)" << std::endl ;
+    }
+
+    server.stop() ;
+    listener.join() ;
+    return 0 ;
+}
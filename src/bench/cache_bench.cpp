@@ -0,0 +1,267 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <functional>
+
+#include <LRUCache.h>
+#include <KeyGenerator.h>
+#include <HdrHistogram.h>
+
+// Drives the caches directly, without HTTP or MySQL in the way:
+//
+//   ./cache_bench [--name=v1,v2,...] ...
+//
+//   --cache=sharded,lru      ShardedLRUCache, or a single LRUCache behind one
+//                            mutex (the cache before sharding)
+//   --threads=1,4            worker threads
+//   --reads=0.95,0.5         share of operations that are lookups; the rest are puts
+//   --distribution=zipfian   key popularity (any load_generator distribution
+//                            except latest)
+//   --capacity=10000         cache entries
+//   --shards=0               ShardedLRUCache shards (0 = 4x hardware threads, >= 1024 entries each)
+//   --keys=100000            key space
+//   --theta=0.99             zipfian skew
+//   --value-size=32          bytes per value
+//   --seconds=2              per configuration
+//
+// Every combination of the listed values is run, one row each. A lookup
+// that misses puts the key, as the server does after reading the DB, so
+// the hit ratio is that of a read-through cache. The cache is first warmed
+// with `capacity` operations. Latency is sampled on one operation in
+// LATENCY_SAMPLE, to keep the clock reads out of the throughput.
+
+const int LATENCY_SAMPLE = 16 ;
+const int64_t LATENCY_HIGHEST_NS = 1000LL * 1000 * 1000 ;
+
+struct BenchConfig {
+    std::string cache ;
+    size_t threads ;
+    double reads ;
+    KeyDistribution distribution ;
+    size_t capacity ;
+    size_t shards ;
+    long long keys ;
+    double theta ;
+    size_t value_size ;
+    int seconds ;
+} ;
+
+struct BenchResult {
+    size_t shards = 1 ;
+    double ops_per_sec = 0 ;
+    uint64_t lookups = 0 ;
+    uint64_t hits = 0 ;
+    HdrHistogram read_ns{1, LATENCY_HIGHEST_NS, 3} ;
+    HdrHistogram write_ns{1, LATENCY_HIGHEST_NS, 3} ;
+} ;
+
+// The two caches behind one interface: lookup (true on a hit) and put
+struct BenchCache {
+    std::function<bool(long long, std::string &)> lookup ;
+    std::function<void(long long, const std::string &)> put ;
+} ;
+
+BenchResult run(const BenchConfig &config)
+{
+    std::unique_ptr<ShardedLRUCache> sharded ;
+    std::unique_ptr<LRUCache<long long, std::string>> single ;
+    std::mutex single_mutex ;
+    BenchCache cache ;
+    if (config.cache == "sharded") {
+        sharded.reset(new ShardedLRUCache(config.capacity, config.shards)) ;
+        cache.lookup = [&](long long key, std::string &out) { return sharded->Get(key, out) ; } ;
+        cache.put = [&](long long key, const std::string &value) { sharded->Put(key, value) ; } ;
+    } else {
+        single.reset(new LRUCache<long long, std::string>(config.capacity)) ;
+        cache.lookup = [&](long long key, std::string &out) {
+            std::lock_guard<std::mutex> lock(single_mutex) ;
+            return single->Get(key, out) ;
+        } ;
+        cache.put = [&](long long key, const std::string &value) {
+            std::lock_guard<std::mutex> lock(single_mutex) ;
+            single->Put(key, value) ;
+        } ;
+    }
+
+    KeyDistributionOptions key_options ;
+    key_options.kind = config.distribution ;
+    key_options.keys = config.keys ;
+    key_options.theta = config.theta ;
+    std::unique_ptr<ZipfianParams> zipfian ;
+    if (config.distribution == KeyDistribution::Zipfian || config.distribution == KeyDistribution::ScrambledZipfian)
+        zipfian.reset(new ZipfianParams(config.keys, config.theta)) ;
+
+    const std::string value(config.value_size, 'x') ;
+    {
+        KeyGenerator warm(key_options, zipfian.get(), 0, 1, 42) ;
+        for (size_t i = 0; i < config.capacity; ++i) cache.put(warm.Next(), value) ;
+    }
+
+    std::atomic<bool> go{false}, stop{false} ;
+    std::mutex result_mutex ;
+    BenchResult result ;
+    uint64_t total_ops = 0 ;
+    std::vector<std::thread> workers ;
+
+    for (size_t t = 0; t < config.threads; ++t) {
+        workers.emplace_back([&, t]() {
+            KeyGenerator keys(key_options, zipfian.get(), static_cast<int>(t), static_cast<int>(config.threads), 1000 + t) ;
+            std::mt19937_64 rng(t + 1) ;
+            std::uniform_real_distribution<double> pick(0.0, 1.0) ;
+            HdrHistogram read_ns(1, LATENCY_HIGHEST_NS, 3) ;
+            HdrHistogram write_ns(1, LATENCY_HIGHEST_NS, 3) ;
+            std::string out ;
+            uint64_t ops = 0, lookups = 0, hits = 0 ;
+
+            while (!go) std::this_thread::yield() ;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    long long key = keys.Next() ;
+                    bool read = pick(rng) < config.reads ;
+                    bool timed = (i % LATENCY_SAMPLE) == 0 ;
+                    auto start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point() ;
+                    if (read) {
+                        ++lookups ;
+                        if (cache.lookup(key, out)) ++hits ;
+                        else cache.put(key, value) ;        // read-through fill
+                    } else {
+                        cache.put(key, value) ;
+                    }
+                    if (timed) {
+                        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() ;
+                        (read ? read_ns : write_ns).Record(ns) ;
+                    }
+                }
+                ops += 256 ;
+            }
+
+            std::lock_guard<std::mutex> lock(result_mutex) ;
+            total_ops += ops ;
+            result.lookups += lookups ;
+            result.hits += hits ;
+            result.read_ns.Add(read_ns) ;
+            result.write_ns.Add(write_ns) ;
+        }) ;
+    }
+
+    auto start = std::chrono::steady_clock::now() ;
+    go = true ;
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds)) ;
+    stop = true ;
+    for (auto &w : workers) w.join() ;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() ;
+
+    if (sharded) result.shards = sharded->ShardCount() ;
+    result.ops_per_sec = total_ops / elapsed ;
+    return result ;
+}
+
+void print_header()
+{
+    std::cout << std::left << std::setw(9) << "cache" << std::right << std::setw(8) << "threads" << std::setw(7) << "reads"
+              << "  " << std::left << std::setw(18) << "distribution" << std::right << std::setw(10) << "capacity"
+              << std::setw(8) << "shards" << std::setw(14) << "ops/s" << std::setw(8) << "hit %"
+              << std::setw(10) << "get p50" << std::setw(10) << "get p99" << std::setw(10) << "get p999"
+              << std::setw(10) << "put p50" << std::setw(10) << "put p99" << "   (ns)" << std::endl ;
+}
+
+void report(const BenchConfig &config, const BenchResult &r)
+{
+    double hit_ratio = r.lookups ? 100.0 * r.hits / r.lookups : 0.0 ;
+    std::cout << std::left << std::setw(9) << config.cache << std::right << std::setw(8) << config.threads
+              << std::setw(7) << std::fixed << std::setprecision(2) << config.reads
+              << "  " << std::left << std::setw(18) << key_distribution_name(config.distribution) << std::right
+              << std::setw(10) << config.capacity << std::setw(8) << r.shards
+              << std::setw(14) << std::setprecision(0) << r.ops_per_sec
+              << std::setw(8) << std::setprecision(1) << hit_ratio
+              << std::setw(10) << r.read_ns.ValueAtPercentile(50.0) << std::setw(10) << r.read_ns.ValueAtPercentile(99.0)
+              << std::setw(10) << r.read_ns.ValueAtPercentile(99.9)
+              << std::setw(10) << r.write_ns.ValueAtPercentile(50.0) << std::setw(10) << r.write_ns.ValueAtPercentile(99.0)
+              << std::endl ;
+}
+
+// "a,b,c" -> {parse(a), parse(b), parse(c)}
+template <typename T, typename Parse>
+std::vector<T> parse_list(const std::string &spec, Parse parse)
+{
+    std::vector<T> values ;
+    std::stringstream ss(spec) ;
+    std::string item ;
+    while (std::getline(ss, item, ',')) values.push_back(parse(item)) ;
+    if (values.empty()) throw std::invalid_argument("empty list") ;
+    return values ;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency()) ;
+    std::vector<std::string> caches = {"sharded", "lru"} ;
+    std::vector<size_t> threads = {1, hardware} ;
+    std::vector<double> reads = {0.95, 0.5} ;
+    std::vector<KeyDistribution> distributions = {KeyDistribution::Zipfian} ;
+    std::vector<size_t> capacities = {10000} ;
+    std::vector<size_t> shards = {0} ;
+    long long keys = 100000 ;
+    double theta = 0.99 ;
+    size_t value_size = 32 ;
+    int seconds = 2 ;
+    if (hardware == 1) threads = {1} ;
+
+    try {
+        auto to_size = [](const std::string &s) { return static_cast<size_t>(std::stoul(s)) ; } ;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i] ;
+            size_t eq = arg.find('=') ;
+            if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) throw std::invalid_argument(arg) ;
+            std::string name = arg.substr(2, eq - 2) ;
+            std::string value = arg.substr(eq + 1) ;
+            if (name == "cache") caches = parse_list<std::string>(value, [](const std::string &s) {
+                if (s != "sharded" && s != "lru") throw std::invalid_argument("cache " + s) ;
+                return s ;
+            }) ;
+            else if (name == "threads") threads = parse_list<size_t>(value, to_size) ;
+            else if (name == "reads") reads = parse_list<double>(value, [](const std::string &s) { return std::stod(s) ; }) ;
+            else if (name == "distribution") distributions = parse_list<KeyDistribution>(value, parse_key_distribution) ;
+            else if (name == "capacity") capacities = parse_list<size_t>(value, to_size) ;
+            else if (name == "shards") shards = parse_list<size_t>(value, to_size) ;
+            else if (name == "keys") keys = std::stoll(value) ;
+            else if (name == "theta") theta = std::stod(value) ;
+            else if (name == "value-size") value_size = to_size(value) ;
+            else if (name == "seconds") seconds = std::stoi(value) ;
+            else throw std::invalid_argument(arg) ;
+        }
+        for (KeyDistribution d : distributions)
+            if (d == KeyDistribution::Latest) throw std::invalid_argument("the latest distribution needs inserts") ;
+        for (size_t t : threads) if (t == 0) throw std::invalid_argument("threads must be positive") ;
+        for (size_t c : capacities) if (c == 0) throw std::invalid_argument("capacity must be positive") ;
+        if (keys < 1 || seconds <= 0) throw std::invalid_argument("keys and seconds must be positive") ;
+    } catch (const std::exception &e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl ;
+        std::cerr << "Usage: " << argv[0] << " [--cache=sharded,lru] [--threads=1,4] [--reads=0.95,0.5]"
+                     " [--distribution=zipfian,uniform] [--capacity=10000] [--shards=0] [--keys=100000]"
+                     " [--theta=0.99] [--value-size=32] [--seconds=2]" << std::endl ;
+        return 1 ;
+    }
+
+    std::cout << "keys: " << keys << ", value size: " << value_size << " bytes, " << seconds
+              << " s per configuration, latency sampled 1 in " << LATENCY_SAMPLE << std::endl ;
+    print_header() ;
+    for (const std::string &cache : caches)
+    for (KeyDistribution distribution : distributions)
+    for (size_t capacity : capacities)
+    for (size_t shard_count : (cache == "sharded" ? shards : std::vector<size_t>{1}))
+    for (double read_share : reads)
+    for (size_t thread_count : threads) {
+        BenchConfig config{cache, thread_count, read_share, distribution, capacity, shard_count, keys, theta, value_size, seconds} ;
+        report(config, run(config)) ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <random>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <LRUCache.h>
+#include <HotKeyCache.h>
+#include <Numa.h>
+
+// Measures how often cache lookups hit memory on a remote NUMA node, with
+// and without the NUMA-aware placement of ShardedLRUCache / HotKeyCache.
+//
+//   ./numa_bench [seconds] [path] [affinity]
+//
+//   path     : shards (lookups through the sharded LRU) or hot (lookups
+//              through the per-CPU hot-key replicas)
+//   affinity : any   - every thread looks up keys from every shard
+//              local - threads only look up keys whose shard lives on their
+//                      own node (what request routing by node would give)
+//
+// Worker threads are pinned round-robin over the nodes. Remote accesses
+// are read from the "node-load-misses" hardware cache event; where perf
+// events are unavailable (containers, perf_event_paranoid) only throughput
+// is reported.
+
+const size_t KEY_SPACE = 200000 ;
+const size_t CAPACITY  = 200000 ;
+const size_t HOT_KEYS  = 64 ;
+const size_t VALUE_SIZE = 128 ;
+
+struct NodeLoadCounters {
+    int loads_fd = -1 ;
+    int misses_fd = -1 ;
+
+    static int open_counter(uint64_t result) {
+        perf_event_attr attr ;
+        std::memset(&attr, 0, sizeof(attr)) ;
+        attr.size = sizeof(attr) ;
+        attr.type = PERF_TYPE_HW_CACHE ;
+        attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16) ;
+        attr.disabled = 1 ;
+        attr.exclude_kernel = 1 ;
+        attr.exclude_hv = 1 ;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)) ;
+    }
+
+    void start() {
+        loads_fd = open_counter(PERF_COUNT_HW_CACHE_RESULT_ACCESS) ;
+        misses_fd = open_counter(PERF_COUNT_HW_CACHE_RESULT_MISS) ;
+        for (int fd : {loads_fd, misses_fd}) {
+            if (fd < 0) continue ;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0) ;
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0) ;
+        }
+    }
+
+    // Returns false when the counters could not be opened
+    bool stop(uint64_t &loads, uint64_t &misses) {
+        loads = misses = 0 ;
+        bool ok = loads_fd >= 0 && misses_fd >= 0 ;
+        for (int fd : {loads_fd, misses_fd}) {
+            if (fd < 0) continue ;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0) ;
+            uint64_t value = 0 ;
+            if (read(fd, &value, sizeof(value)) != sizeof(value)) ok = false ;
+            (fd == loads_fd ? loads : misses) = value ;
+            close(fd) ;
+        }
+        return ok ;
+    }
+} ;
+
+struct RunResult {
+    double ops_per_sec = 0 ;
+    uint64_t node_loads = 0 ;
+    uint64_t node_misses = 0 ;
+    bool counters = true ;
+} ;
+
+RunResult run(bool numa_aware, const std::string &path, bool local_affinity, int seconds, size_t threads)
+{
+    const NumaTopology &topology = NumaTopology::Get() ;
+    ShardedLRUCache cache(CAPACITY, 0, numa_aware) ;
+    HotKeyCache hot(HOT_KEYS, 1, numa_aware) ;
+
+    // Populate from one thread pinned to each node, the way request workers
+    // on every node fill the server's cache. Without NUMA placement entries
+    // and values are first touched, and therefore placed, on the node of
+    // whichever thread inserted them, not on the node of their shard.
+    std::vector<std::thread> fillers ;
+    for (int node = 0; node < topology.Nodes(); ++node) {
+        fillers.emplace_back([&, node]() {
+            topology.PinThreadToNode(node) ;
+            std::string value(VALUE_SIZE, 'x') ;
+            for (size_t key = static_cast<size_t>(node); key < KEY_SPACE; key += topology.Nodes())
+                cache.Put(static_cast<long long>(key), value) ;
+        }) ;
+    }
+    for (auto &f : fillers) f.join() ;
+    if (path == "hot") {
+        for (int round = 0; round < 8; ++round)
+            for (size_t key = 0; key < HOT_KEYS; ++key) hot.Record(static_cast<long long>(key)) ;
+        hot.Refresh(cache) ;
+    }
+
+    // Per node, the keys whose shard lives there (for affinity=local)
+    std::vector<std::vector<long long>> node_keys(topology.Nodes()) ;
+    for (size_t key = 0; key < KEY_SPACE; ++key) {
+        int node = cache.NodeOfShard(cache.ShardOf(static_cast<long long>(key))) ;
+        node_keys[node < 0 ? 0 : node].push_back(static_cast<long long>(key)) ;
+    }
+
+    std::atomic<bool> go{false}, stop{false} ;
+    std::atomic<uint64_t> total_ops{0}, total_loads{0}, total_misses{0} ;
+    std::atomic<bool> counters_ok{true} ;
+    std::vector<std::thread> workers ;
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            int node = static_cast<int>(t % topology.Nodes()) ;
+            topology.PinThreadToNode(node) ;
+            std::mt19937_64 rng(t + 1) ;
+            const std::vector<long long> &local = node_keys[node] ;
+            std::string out ;
+            uint64_t ops = 0 ;
+
+            while (!go) std::this_thread::yield() ;
+            NodeLoadCounters counters ;
+            counters.start() ;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    long long key ;
+                    if (path == "hot") key = static_cast<long long>(rng() % HOT_KEYS) ;
+                    else if (local_affinity && !local.empty()) key = local[rng() % local.size()] ;
+                    else key = static_cast<long long>(rng() % KEY_SPACE) ;
+
+                    if (path == "hot") hot.Get(key, out) ;
+                    else cache.Get(key, out) ;
+                }
+                ops += 256 ;
+            }
+            uint64_t loads = 0, misses = 0 ;
+            if (!counters.stop(loads, misses)) counters_ok = false ;
+            total_ops += ops ;
+            total_loads += loads ;
+            total_misses += misses ;
+        }) ;
+    }
+
+    auto start = std::chrono::steady_clock::now() ;
+    go = true ;
+    std::this_thread::sleep_for(std::chrono::seconds(seconds)) ;
+    stop = true ;
+    for (auto &w : workers) w.join() ;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() ;
+
+    RunResult result ;
+    result.ops_per_sec = total_ops / elapsed ;
+    result.node_loads = total_loads ;
+    result.node_misses = total_misses ;
+    result.counters = counters_ok ;
+    return result ;
+}
+
+void report(const std::string &label, const RunResult &r)
+{
+    std::cout << std::left << std::setw(14) << label
+              << std::right << std::setw(14) << std::fixed << std::setprecision(0) << r.ops_per_sec << " ops/s" ;
+    if (r.counters && r.node_loads > 0) {
+        double remote = 100.0 * r.node_misses / r.node_loads ;
+        std::cout << "   node-loads " << std::setw(12) << r.node_loads
+                  << "   remote " << std::setw(12) << r.node_misses
+                  << "   remote rate " << std::setprecision(1) << remote << " %" ;
+    } else {
+        std::cout << "   (node-load counters unavailable)" ;
+    }
+    std::cout << std::endl ;
+}
+
+int main(int argc, char* argv[])
+{
+    int seconds = 5 ;
+    std::string path = "shards" ;
+    std::string affinity = "any" ;
+    if (argc >= 2) seconds = std::stoi(argv[1]) ;
+    if (argc >= 3) path = argv[2] ;
+    if (argc >= 4) affinity = argv[3] ;
+
+    if ((path != "shards" && path != "hot") || (affinity != "any" && affinity != "local") || seconds <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [seconds] [shards|hot] [any|local]" << std::endl ;
+        return 1 ;
+    }
+
+    const NumaTopology &topology = NumaTopology::Get() ;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency()) ;
+    std::cout << "NUMA nodes: " << topology.Nodes() << ", threads: " << threads
+              << ", path: " << path << ", affinity: " << affinity << std::endl ;
+    if (topology.Nodes() < 2)
+        std::cout << "Single node host: expect no difference between the two placements." << std::endl ;
+
+    report("first-touch", run(false, path, affinity == "local", seconds, threads)) ;
+    report("numa-aware", run(true, path, affinity == "local", seconds, threads)) ;
+    return 0 ;
+}
@@ -0,0 +1,174 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <string>
+#include <algorithm>
+
+#include <ThreadPool.h>
+
+// Round-trip cost of handing a small task to the DB worker pool and waiting
+// for its result, the way the server's HTTP workers do for every DB access.
+//
+//   ./threadpool_bench [seconds] [clients] [workers] [task_us]
+//
+//   clients : submitting threads (the HTTP workers), default 64
+//   workers : pool threads (the DB pool size), default 8
+//   task_us : busy time of each task in microseconds, default 0
+//
+// "mutex" is the previous pool design (one mutex + condition variable +
+// std::queue<std::function>, packaged_task per submit); "lock-free" is
+// ThreadPool::run().
+
+class MutexPool {
+public:
+    explicit MutexPool(size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            workers.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task ;
+                    {
+                        std::unique_lock<std::mutex> lock(mtx) ;
+                        cv.wait(lock, [this] { return stop_flag || !tasks.empty(); }) ;
+                        if (stop_flag && tasks.empty()) return ;
+                        task = std::move(tasks.front()) ;
+                        tasks.pop() ;
+                    }
+                    task() ;
+                }
+            }) ;
+        }
+    }
+
+    ~MutexPool() {
+        {
+            std::unique_lock<std::mutex> lock(mtx) ;
+            stop_flag = true ;
+        }
+        cv.notify_all() ;
+        for (auto &t : workers) t.join() ;
+    }
+
+    template<typename F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        using R = decltype(f()) ;
+        auto task_ptr = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f)) ;
+        std::future<R> fut = task_ptr->get_future() ;
+        {
+            std::unique_lock<std::mutex> lock(mtx) ;
+            tasks.emplace([task_ptr](){ (*task_ptr)(); }) ;
+        }
+        cv.notify_one() ;
+        return fut ;
+    }
+
+private:
+    std::vector<std::thread> workers ;
+    std::queue<std::function<void()>> tasks ;
+    std::mutex mtx ;
+    std::condition_variable cv ;
+    bool stop_flag = false ;
+} ;
+
+static void spin_for(int task_us)
+{
+    if (task_us <= 0) return ;
+    auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(task_us) ;
+    while (std::chrono::steady_clock::now() < until) {}
+}
+
+struct RunResult {
+    double ops_per_sec = 0 ;
+    double mean_us = 0 ;
+    double p99_us = 0 ;
+} ;
+
+template <typename RoundTrip>
+RunResult run(RoundTrip round_trip, int seconds, size_t clients)
+{
+    std::atomic<bool> go{false}, stop{false} ;
+    std::vector<std::vector<double>> latencies(clients) ;
+    std::vector<std::thread> threads ;
+
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            std::vector<double> &lat = latencies[c] ;
+            lat.reserve(1 << 16) ;
+            while (!go) std::this_thread::yield() ;
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto t0 = std::chrono::steady_clock::now() ;
+                round_trip(static_cast<long long>(c)) ;
+                lat.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count()) ;
+            }
+        }) ;
+    }
+
+    auto start = std::chrono::steady_clock::now() ;
+    go = true ;
+    std::this_thread::sleep_for(std::chrono::seconds(seconds)) ;
+    stop = true ;
+    for (auto &t : threads) t.join() ;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() ;
+
+    std::vector<double> all ;
+    for (auto &lat : latencies) all.insert(all.end(), lat.begin(), lat.end()) ;
+    RunResult result ;
+    if (all.empty()) return result ;
+    double sum = 0 ;
+    for (double v : all) sum += v ;
+    size_t p99 = std::min(all.size() - 1, all.size() * 99 / 100) ;
+    std::nth_element(all.begin(), all.begin() + p99, all.end()) ;
+    result.ops_per_sec = all.size() / elapsed ;
+    result.mean_us = sum / all.size() ;
+    result.p99_us = all[p99] ;
+    return result ;
+}
+
+void report(const std::string &label, const RunResult &r)
+{
+    std::cout << std::left << std::setw(12) << label << std::right << std::fixed
+              << std::setw(12) << std::setprecision(0) << r.ops_per_sec << " ops/s"
+              << "   mean " << std::setw(8) << std::setprecision(1) << r.mean_us << " us"
+              << "   p99 " << std::setw(8) << r.p99_us << " us" << std::endl ;
+}
+
+int main(int argc, char* argv[])
+{
+    int seconds = 5 ;
+    size_t clients = 64 ;
+    size_t workers = 8 ;
+    int task_us = 0 ;
+    if (argc >= 2) seconds = std::stoi(argv[1]) ;
+    if (argc >= 3) clients = std::stoul(argv[2]) ;
+    if (argc >= 4) workers = std::stoul(argv[3]) ;
+    if (argc >= 5) task_us = std::stoi(argv[4]) ;
+
+    if (seconds <= 0 || clients == 0 || workers == 0) {
+        std::cerr << "Usage: " << argv[0] << " [seconds] [clients] [workers] [task_us]" << std::endl ;
+        return 1 ;
+    }
+
+    std::cout << "clients: " << clients << ", workers: " << workers << ", task: " << task_us << " us" << std::endl ;
+
+    {
+        MutexPool pool(workers) ;
+        report("mutex", run([&](long long key) {
+            auto fut = pool.submit([key, task_us]() -> long long { spin_for(task_us); return key + 1; }) ;
+            return fut.get() ;
+        }, seconds, clients)) ;
+    }
+    {
+        ThreadPool pool(workers) ;
+        report("lock-free", run([&](long long key) {
+            return pool.run([key, task_us]() -> long long { spin_for(task_us); return key + 1; }) ;
+        }, seconds, clients)) ;
+    }
+    return 0 ;
+}
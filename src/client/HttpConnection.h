@@ -0,0 +1,197 @@
+#ifndef HttpConnection_H
+#define HttpConnection_H
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+
+/**
+ * @brief One non-blocking HTTP/1.1 keep-alive connection, for the async
+ * engine of the load generator. Requests are appended to an output buffer
+ * and written whenever the socket accepts data, so any number of them can
+ * be pipelined; responses are parsed as they arrive, in order.
+ *
+ * Only responses with a Content-Length (what cpp-httplib sends for the KV
+ * server's replies) are understood; anything else closes the connection.
+ * The caller owns the event loop: it polls Fd() and calls Flush() when the
+ * socket is writable and Receive() when it is readable.
+ */
+class HttpConnection {
+public:
+    HttpConnection() = default ;
+    HttpConnection(const HttpConnection&) = delete ;
+    HttpConnection& operator=(const HttpConnection&) = delete ;
+    ~HttpConnection() { Close() ; }
+
+    /**
+     * @brief Resolves `host` once; every connection of a run reuses the address.
+     */
+    static bool Resolve(const std::string& host, int port, sockaddr_storage& addr, socklen_t& addr_len)
+    {
+        addrinfo hints ;
+        std::memset(&hints, 0, sizeof(hints)) ;
+        hints.ai_family = AF_UNSPEC ;
+        hints.ai_socktype = SOCK_STREAM ;
+        addrinfo* result = nullptr ;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) return false ;
+        std::memcpy(&addr, result->ai_addr, result->ai_addrlen) ;
+        addr_len = result->ai_addrlen ;
+        freeaddrinfo(result) ;
+        return true ;
+    }
+
+    /**
+     * @brief Connects (blocking, so the connection is usable right away) and
+     * then switches the socket to non-blocking mode.
+     */
+    bool Connect(const sockaddr_storage& addr, socklen_t addr_len)
+    {
+        Close() ;
+        _fd = socket(addr.ss_family, SOCK_STREAM, 0) ;
+        if (_fd < 0) return false ;
+        if (connect(_fd, reinterpret_cast<const sockaddr*>(&addr), addr_len) != 0) {
+            Close() ;
+            return false ;
+        }
+        int one = 1 ;
+        setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) ;
+        fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK) ;
+        _server_closing = false ;
+        return true ;
+    }
+
+    void Close()
+    {
+        if (_fd >= 0) ::close(_fd) ;
+        _fd = -1 ;
+        _out.clear() ;
+        _out_pos = 0 ;
+        _in.clear() ;
+        _in_pos = 0 ;
+    }
+
+    int Fd() const                  { return _fd ; }
+    bool IsOpen() const             { return _fd >= 0 ; }
+    bool WantsWrite() const         { return _out_pos < _out.size() ; }
+    // The server announced it will close after its last response (keep-alive limit)
+    bool ServerClosing() const      { return _server_closing ; }
+
+    void Queue(const std::string& request) { _out += request ; }
+
+    /**
+     * @brief Writes as much of the output buffer as the socket takes.
+     * Returns false when the connection failed.
+     */
+    bool Flush()
+    {
+        while (_out_pos < _out.size()) {
+            ssize_t n = ::send(_fd, _out.data() + _out_pos, _out.size() - _out_pos, MSG_NOSIGNAL) ;
+            if (n > 0) {
+                _out_pos += n ;
+                continue ;
+            }
+            if (n < 0 && errno == EINTR) continue ;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true ;
+            return false ;
+        }
+        _out.clear() ;
+        _out_pos = 0 ;
+        return true ;
+    }
+
+    /**
+     * @brief Reads whatever is available and calls `on_response(status)` for
+     * every complete response, in order. Returns false when the connection
+     * was closed (by the server or because of an error or a response that
+     * could not be parsed); responses received before that are delivered.
+     */
+    template <typename F>
+    bool Receive(F&& on_response)
+    {
+        char buf[16384] ;
+        bool received = false ;
+        for (;;) {
+            ssize_t n = ::recv(_fd, buf, sizeof(buf), 0) ;
+            if (n > 0) {
+                _in.append(buf, n) ;
+                received = true ;
+                continue ;
+            }
+            if (n < 0 && errno == EINTR) continue ;
+            bool open = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ;
+            // cpp-httplib writes the headers and the body of a response
+            // separately; a delayed ACK of the headers would hold the body
+            // back for ~40 ms (Nagle), so acknowledge right away
+            if (open && received) {
+                int one = 1 ;
+                setsockopt(_fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one)) ;
+            }
+            if (!parse(on_response)) return false ;
+            return open ;
+        }
+    }
+
+private:
+    template <typename F>
+    bool parse(F& on_response)
+    {
+        for (;;) {
+            size_t header_end = _in.find("\r\n\r\n", _in_pos) ;
+            if (header_end == std::string::npos) break ;
+            const char* head = _in.data() + _in_pos ;
+            size_t head_len = header_end - _in_pos ;
+            // "HTTP/1.1 200 OK"
+            if (head_len < 12 || std::strncmp(head, "HTTP/1.", 7) != 0) return false ;
+            int status = std::atoi(head + 9) ;
+
+            long long content_length = -1 ;
+            std::string_view headers(head, head_len) ;
+            for (size_t line = headers.find("\r\n") ; line != std::string_view::npos ; ) {
+                size_t next = headers.find("\r\n", line + 2) ;
+                std::string_view h = headers.substr(line + 2, next == std::string_view::npos ? std::string_view::npos : next - (line + 2)) ;
+                if (h.size() > 15 && strncasecmp(h.data(), "Content-Length:", 15) == 0) {
+                    std::string_view v = h.substr(15) ;
+                    while (!v.empty() && v.front() == ' ') v.remove_prefix(1) ;
+                    std::from_chars(v.data(), v.data() + v.size(), content_length) ;
+                } else if (h.size() >= 17 && strncasecmp(h.data(), "Connection: close", 17) == 0) {
+                    _server_closing = true ;
+                } else if (h.size() > 18 && strncasecmp(h.data(), "Transfer-Encoding:", 18) == 0) {
+                    return false ;      // chunked bodies are not supported
+                }
+                line = next ;
+            }
+            if (content_length < 0) return false ;     // no way to tell where the body ends
+
+            size_t body_start = header_end + 4 ;
+            if (_in.size() - body_start < (size_t)content_length) break ;
+            _in_pos = body_start + content_length ;
+            on_response(status) ;
+        }
+        // Drop consumed responses once they make up most of the buffer
+        if (_in_pos > 0 && _in_pos * 2 >= _in.size()) {
+            _in.erase(0, _in_pos) ;
+            _in_pos = 0 ;
+        }
+        return true ;
+    }
+
+    int _fd = -1 ;
+    std::string _out ;
+    size_t _out_pos = 0 ;
+    std::string _in ;
+    size_t _in_pos = 0 ;
+    bool _server_closing = false ;
+} ;
+
+#endif
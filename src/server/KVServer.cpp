@@ -10,6 +10,7 @@
 #include <unordered_map>
 #include <mutex>
 #include <future>
+#include <csignal>
 
 #include "KVServer.h"
 #include <LRUCache.h>
@@ -19,29 +20,116 @@
 using namespace std::chrono_literals;
 #define PORT 8080
 
+// Rows returned by /scan when no count is given, and the most it will return
+const long long DEFAULT_SCAN_COUNT = 10 ;
+const long long MAX_SCAN_COUNT = 1000 ;
+
 // ------------------------------ DB ACCESS METHODS -------------------------------------
 
-std::optional<std::string> db_select_value(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long key) ; 
+// `failed` (optional) tells a query error apart from a missing key
+std::optional<std::string> db_select_value(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long key, bool *failed = nullptr) ; 
 bool db_upsert(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long key, const std::string &value) ; 
 std::pair<bool, uint64_t> db_delete(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long key) ;
+bool db_select_recent(MYSQL* conn, const std::string &db_name, const std::string &table_name, size_t limit, size_t offset, std::vector<std::pair<long long, std::string>> &rows) ;
+bool db_select_range(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long start_key, size_t limit, std::vector<std::pair<long long, std::string>> &rows) ;
+int db_key_is_integer(MYSQL* conn, const std::string &db_name, const std::string &table_name) ;
 
 // -------------------------------------------------------------------------------------
 
-KVServer::KVServer(const std::string &db_user,
-                   const std::string &db_password,
-                   const std::string &db_host,
-                   const std::string &db_name,
+// Parses the integer "key" query parameter without allocating; answers 400
+// itself when the parameter is missing or not an integer
+static bool parse_key(const httplib::Request &req, httplib::Response &res, long long &key)
+{
+    switch (parse_integer_param(req, "key", key)) {
+    case ParamParse::Ok:
+        return true;
+    case ParamParse::Missing:
+        res.status = 400 ; // Bad Request
+        res.set_content("Missing Key parameter", "text/plain") ;
+        return false;
+    case ParamParse::Invalid:
+        break;
+    }
+    res.status = 400;
+    res.set_content("Key must be an integer", "text/plain");
+    return false;
+}
+
+// The DB lane shed this request: tell the client to back off instead of letting it time out
+static void respond_overloaded(httplib::Response &res, const DBOverloaded &e)
+{
+    res.status = 503;
+    res.set_header("Retry-After", std::to_string(e.RetryAfterSec()));
+    res.set_content("Server overloaded, retry later", "text/plain");
+}
+
+// Adds one request to the trace when the handler returns, with its arrival
+// time and final status. The value size is the one given, or else the size
+// of a 200 response body (a GET hit). Costs one branch when tracing is off.
+class TracedRequest {
+public:
+    TracedRequest(TraceRecorder &trace, TraceOp op, long long key, const httplib::Response &res, size_t value_size = 0)
+        : _trace(trace), _op(op), _key(key), _response(res), _value_size(value_size)
+    {
+        if (_trace.Enabled()) _arrival = std::chrono::steady_clock::now();
+    }
+
+    ~TracedRequest()
+    {
+        if (!_trace.Enabled()) return;
+        size_t size = _value_size ? _value_size : (_response.status == 200 ? _response.body.size() : 0);
+        _trace.Record(_arrival, _op, _key, size, _response.status);
+    }
+
+private:
+    TraceRecorder &_trace;
+    TraceOp _op;
+    long long _key;
+    const httplib::Response &_response;
+    size_t _value_size;
+    std::chrono::steady_clock::time_point _arrival;
+};
+
+// Adds one request to its route's latency histogram and response counts
+// when the handler returns
+class MeasuredRequest {
+public:
+    MeasuredRequest(ServerMetrics &metrics, Route route, const httplib::Response &res)
+        : _metrics(metrics), _route(static_cast<size_t>(route)), _response(res), _start(std::chrono::steady_clock::now()) {}
+
+    ~MeasuredRequest()
+    {
+        _metrics.request_latency[_route].Observe(elapsed_us(_start));
+        int status_class = std::min(std::max(_response.status / 100, 1), 5);
+        _metrics.responses[_route][status_class - 1].Add();
+    }
+
+private:
+    ServerMetrics &_metrics;
+    size_t _route;
+    const httplib::Response &_response;
+    std::chrono::steady_clock::time_point _start;
+};
+
+KVServer::KVServer(std::unique_ptr<KVStore> store,
                    size_t pool_size,
                    size_t cache_capacity,
-                   const std::string &table_name)
+                   const KVServerOptions &options)
         :  _pool(pool_size),
-          _dbpool(DBPool (db_host, PORT, db_user, db_password, db_name, pool_size)),
-          _db_name(db_name),
-          _table_name(table_name),
-          _cache(cache_capacity, 8)
+          _db(_pool, pool_size, options.db_lanes),
+          _store(std::move(store)),
+          _cache(cache_capacity, options.cache_shards, options.numa_aware),
+          _hot(options.hot_keys, options.hot_sample_every, options.numa_aware),
+          _options(options),
+          _limiter(options.rate_limit)
 {
-    std::cout << "KVServer running." << std::endl;
-    Run(PORT) ;
+    if (_options.numa_aware) {
+        _http_server.new_task_queue = [] { return new NumaTaskQueue(CPPHTTPLIB_THREAD_POOL_COUNT); };
+        std::cout << "NUMA-aware mode across " << NumaTopology::Get().Nodes() << " node(s)." << std::endl;
+    } else {
+        _http_server.new_task_queue = [] { return new TimedTaskQueue(CPPHTTPLIB_THREAD_POOL_COUNT); };
+    }
+    std::cout << "KVServer running with " << _cache.ShardCount() << " cache shards over the " << _store->Describe() << "." << std::endl;
 }
 
 KVServer::~KVServer() 
@@ -50,95 +138,421 @@ KVServer::~KVServer()
     if (_http_server.is_running()) {
         _http_server.stop();
     }
+    stop_maintenance();
+    if (_warmup_thread.joinable()) _warmup_thread.join();
 
     std::cout << "KVServer shut down successfully." << std::endl;
 }
 
+void KVServer::Stop()
+{
+    // httplib ignores stop() unless listen() is already running, so the
+    // request is also remembered for Run() and the maintenance thread
+    _stop_requested = true;
+    _http_server.stop();
+}
+
+// --------------------------- Cache snapshots ---------------------------
+
+void KVServer::load_snapshot()
+{
+    if (_options.snapshot_path.empty()) return;
+
+    auto start = std::chrono::steady_clock::now();
+    long long loaded = _cache.LoadSnapshot(_options.snapshot_path);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    if (loaded < 0) {
+        std::cout << "No usable cache snapshot at " << _options.snapshot_path << ", starting cold." << std::endl;
+        return;
+    }
+    std::cout << "Loaded " << loaded << " cache entries from " << _options.snapshot_path
+              << " in " << elapsed.count() << " ms" << std::endl;
+}
+
+void KVServer::save_snapshot()
+{
+    if (_options.snapshot_path.empty()) return;
+
+    long long saved = _cache.SaveSnapshot(_options.snapshot_path);
+    if (saved < 0) {
+        std::cerr << "Failed to write cache snapshot to " << _options.snapshot_path << std::endl;
+        return;
+    }
+#ifdef DEBUG_MODE
+    std::cout << "Saved " << saved << " cache entries to " << _options.snapshot_path << std::endl;
+#endif
+}
+
+void KVServer::warmup_from_db()
+{
+    if (_options.warmup_keys == 0) {
+        _ready = true;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t connections = std::max<size_t>(1, _options.warmup_connections);
+    size_t chunk = (_options.warmup_keys + connections - 1) / connections;
+
+    // Connection i streams the i-th slice of the keys ordered by recency. Each
+    // slice is inserted oldest first so the newest keys end up most recently used.
+    // Requests are already being served, so a key written or deleted since its
+    // row was read keeps what the request put in the cache. The slices share
+    // the read lane with those requests (and hold its connections), so they
+    // are admitted by the scheduler like any other read and back off when shed.
+    std::atomic<size_t> loaded{0};
+    std::vector<std::thread> loaders;
+    for (size_t i = 0; i < connections; ++i) {
+        loaders.emplace_back([this, i, chunk, &loaded]() {
+            std::vector<std::pair<long long, std::string>> rows;
+            bool ok = false;
+            while (!_stop_requested) {
+                try {
+                    ok = _db.Run(DBLane::Read, [this, i, chunk, &rows]() -> bool {
+                        return _store->SelectRecent(chunk, i * chunk, rows);
+                    });
+                    break;
+                } catch (const DBOverloaded &e) {
+                    std::this_thread::sleep_for(std::chrono::seconds(e.RetryAfterSec()));
+                }
+            }
+            if (!ok) {
+                if (_stop_requested) return;
+                std::cerr << "Warm-up query failed on the " << _store->Describe() << std::endl;
+                return;
+            }
+            size_t stored = 0;
+            for (auto it = rows.rbegin(); it != rows.rend(); ++it)
+                stored += _cache.PutIfAbsent(it->first, it->second, _options.cache_ttl_sec);
+            loaded.fetch_add(stored);
+        });
+    }
+    for (auto &t : loaders) t.join();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Warmed cache with " << loaded.load() << " keys from the DB in " << elapsed.count() << " ms" << std::endl;
+    _ready = true;
+}
+
+void KVServer::start_maintenance()
+{
+    std::lock_guard<std::mutex> lock(_maintenance_mutex);
+    if (_maintenance_thread.joinable()) return;
+    _maintenance_stop = false;
+    _maintenance_thread = std::thread(&KVServer::maintenance_loop, this);
+}
+
+void KVServer::stop_maintenance()
+{
+    {
+        std::lock_guard<std::mutex> lock(_maintenance_mutex);
+        _maintenance_stop = true;
+    }
+    _maintenance_cv.notify_all();
+    if (_maintenance_thread.joinable()) _maintenance_thread.join();
+}
+
+void KVServer::maintenance_loop()
+{
+    auto next_snapshot = std::chrono::steady_clock::now() + std::chrono::seconds(_options.snapshot_interval_sec);
+
+    std::unique_lock<std::mutex> lock(_maintenance_mutex);
+    while (!_maintenance_cv.wait_for(lock, 1s, [this] { return _maintenance_stop; })) {
+        lock.unlock();
+        // Repeat a Stop() that landed while listen() was still starting up
+        if (_stop_requested && _http_server.is_running()) _http_server.stop();
+        auto now = std::chrono::steady_clock::now();
+        _cache.ExpireTick();
+        _hot.Refresh(_cache);
+        if (_options.snapshot_interval_sec > 0 && now >= next_snapshot) {
+            save_snapshot();
+            next_snapshot = now + std::chrono::seconds(_options.snapshot_interval_sec);
+        }
+        lock.lock();
+    }
+}
+
 
 // Register the callback functions for get put update and delete
 void KVServer::setup_routes() 
 {
+    // Only a connection's first request waited in the task queue
+    _http_server.set_post_routing_handler([](const httplib::Request &, httplib::Response &) {
+        RequestQueueTime::Clear();
+    });
+
+    // Rate limits are enforced before routing, i.e. before any cache or DB work
+    if (_limiter.Enabled()) {
+        _http_server.set_pre_routing_handler([this](const httplib::Request &req, httplib::Response &res) {
+            return admit_client(req, res) ? httplib::Server::HandlerResponse::Unhandled
+                                          : httplib::Server::HandlerResponse::Handled;
+        });
+    }
+
     _http_server.Get("/get", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Get, res);
         HandleGet(req, res);
     });
 
     _http_server.Put("/put", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Put, res);
         HandlePut(req, res);
     });
 
     _http_server.Delete("/delete", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Delete, res);
         HandleDelete(req, res);
     });
 
     _http_server.Get("/get_popular", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::GetPopular, res);
         HandleGetPopular(req, res);
     });
+
+    _http_server.Get("/scan", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Scan, res);
+        HandleScan(req, res);
+    });
+
+    _http_server.Get("/stats", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Stats, res);
+        HandleStats(req, res);
+    });
+
+    _http_server.Get("/metrics", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Metrics, res);
+        HandleMetrics(req, res);
+    });
+
+    _http_server.Get("/healthz", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Health, res);
+        HandleHealth(req, res);
+    });
+
+    _http_server.Get("/readyz", [this](const httplib::Request &req, httplib::Response &res) {
+        MeasuredRequest measured(_metrics, Route::Ready, res);
+        HandleReady(req, res);
+    });
+}
+
+bool KVServer::admit_client(const httplib::Request& req, httplib::Response& res)
+{
+    // Probes, stats and metrics must keep answering for limited clients too
+    if (req.path == "/healthz" || req.path == "/readyz" || req.path == "/stats" || req.path == "/metrics") return true;
+
+    std::string client;
+    if (!_options.rate_limit_header.empty()) client = req.get_header_value(_options.rate_limit_header);
+    if (client.empty()) client = req.remote_addr;
+
+    uint64_t retry_after_ms = 0;
+    if (_limiter.Allow(client, retry_after_ms)) return true;
+
+    res.status = 429;
+    res.set_header("Retry-After", std::to_string((retry_after_ms + 999) / 1000));
+    res.set_content("Rate limit exceeded", "text/plain");
+    return false;
+}
+
+void KVServer::HandleStats(const httplib::Request& /*req*/, httplib::Response& res)
+{
+    auto shards = _cache.Stats();
+    size_t total_size = 0, max_size = 0;
+    uint64_t total_ops = 0, max_ops = 0;
+    for (auto &st : shards) {
+        uint64_t ops = st.lookups + st.writes;
+        total_size += st.size;
+        total_ops += ops;
+        max_size = std::max(max_size, st.size);
+        max_ops = std::max(max_ops, ops);
+    }
+
+    // Imbalance = busiest shard / average shard (1.0 means perfectly even)
+    double n = static_cast<double>(shards.size());
+    double size_imbalance = total_size ? max_size / (total_size / n) : 0.0;
+    double ops_imbalance = total_ops ? max_ops / (total_ops / n) : 0.0;
+
+    std::ostringstream out;
+    out << "cache_shards " << shards.size() << "\n";
+    out << "cache_size " << total_size << "\n";
+    out << "shard_size_imbalance " << size_imbalance << "\n";
+    out << "shard_ops_imbalance " << ops_imbalance << "\n";
+    out << "hot_keys_published " << _hot.Published() << "\n";
+    for (DBLane lane : {DBLane::Read, DBLane::Write}) {
+        DBLaneStats st = _db.Stats(lane);
+        const char *name = lane == DBLane::Read ? "read" : "write";
+        out << "db_lane " << name << " reserved=" << _db.Reserved(lane) << " queued=" << st.queued
+            << " in_flight=" << st.in_flight << " completed=" << st.completed
+            << " wait_us_avg=" << (st.completed ? st.wait_us_total / st.completed : 0)
+            << " wait_us_max=" << st.wait_us_max << " shed=" << st.shed
+            << " overloaded=" << (st.overloaded ? 1 : 0) << "\n";
+    }
+    out << "rate_limit_rejected " << _limiter.Rejected() << "\n";
+    for (auto &client : _limiter.Stats()) {
+        out << "rate_limit_client " << client.client << " allowed=" << client.allowed
+            << " rejected=" << client.rejected << "\n";
+    }
+    for (size_t i = 0; i < shards.size(); ++i) {
+        const ShardStats &st = shards[i];
+        out << "shard " << i << " size=" << st.size << " lookups=" << st.lookups << " hits=" << st.hits
+            << " writes=" << st.writes << " evictions=" << st.evictions << "\n";
+    }
+
+    res.status = 200;
+    res.set_content(out.str(), "text/plain");
+}
+
+static const char *ROUTE_NAMES[] = {"get", "put", "delete", "get_popular", "scan", "stats", "metrics", "healthz", "readyz"};
+static_assert(sizeof(ROUTE_NAMES) / sizeof(ROUTE_NAMES[0]) == static_cast<size_t>(Route::Count), "one name per route");
+
+void KVServer::HandleMetrics(const httplib::Request& /*req*/, httplib::Response& res)
+{
+    std::ostringstream out;
+    MetricsWriter metrics(out);
+    const size_t routes = static_cast<size_t>(Route::Count);
+
+    metrics.Family("kv_requests_total", "counter", "Requests answered, by route and status class.");
+    for (size_t r = 0; r < routes; ++r)
+        for (size_t c = 0; c < ServerMetrics::STATUS_CLASSES; ++c) {
+            uint64_t n = _metrics.responses[r][c].Value();
+            if (n) metrics.Sample("kv_requests_total", std::string("route=\"") + ROUTE_NAMES[r] + "\",code=\"" + std::to_string(c + 1) + "xx\"", n);
+        }
+    metrics.Family("kv_request_duration_seconds", "histogram", "Time spent in the route handler.");
+    for (size_t r = 0; r < routes; ++r)
+        metrics.Histogram("kv_request_duration_seconds", std::string("route=\"") + ROUTE_NAMES[r] + "\"", _metrics.request_latency[r].Collect());
+    metrics.Family("kv_rate_limited_total", "counter", "Requests rejected with 429 before routing.");
+    metrics.Sample("kv_rate_limited_total", "", _limiter.Rejected());
+
+    auto shards = _cache.Stats();
+    const char *shard_families[][3] = {
+        {"kv_cache_entries", "gauge", "Entries held by the cache shard."},
+        {"kv_cache_capacity", "gauge", "Entries the cache shard can hold."},
+        {"kv_cache_lookups_total", "counter", "Cache shard lookups."},
+        {"kv_cache_hits_total", "counter", "Cache shard lookups that found a value."},
+        {"kv_cache_misses_total", "counter", "Cache shard lookups that found no value."},
+        {"kv_cache_writes_total", "counter", "Cache shard writes."},
+        {"kv_cache_evictions_total", "counter", "Entries evicted from the cache shard for capacity."}};
+    for (size_t f = 0; f < sizeof(shard_families) / sizeof(shard_families[0]); ++f) {
+        metrics.Family(shard_families[f][0], shard_families[f][1], shard_families[f][2]);
+        for (size_t i = 0; i < shards.size(); ++i) {
+            const ShardStats &st = shards[i];
+            uint64_t values[] = {st.size, st.capacity, st.lookups, st.hits, st.lookups - st.hits, st.writes, st.evictions};
+            metrics.Sample(shard_families[f][0], "shard=\"" + std::to_string(i) + "\"", values[f]);
+        }
+    }
+    metrics.Family("kv_hot_key_hits_total", "counter", "Reads answered by the per-CPU hot-key replicas, before the cache shards.");
+    metrics.Sample("kv_hot_key_hits_total", "", _metrics.hot_key_hits.Value());
+
+    metrics.Family("kv_db_connections", "gauge", "DB connections in the pool.");
+    metrics.Sample("kv_db_connections", "", static_cast<uint64_t>(_db.Slots()));
+    DBLaneStats lanes[2] = {_db.Stats(DBLane::Read), _db.Stats(DBLane::Write)};
+    const char *lane_labels[2] = {"lane=\"read\"", "lane=\"write\""};
+    metrics.Family("kv_db_connections_in_use", "gauge", "DB connections running a query, by lane.");
+    for (int l = 0; l < 2; ++l) metrics.Sample("kv_db_connections_in_use", lane_labels[l], static_cast<uint64_t>(lanes[l].in_flight));
+    metrics.Family("kv_db_queued", "gauge", "Requests waiting for a DB connection, by lane.");
+    for (int l = 0; l < 2; ++l) metrics.Sample("kv_db_queued", lane_labels[l], static_cast<uint64_t>(lanes[l].queued));
+    metrics.Family("kv_db_shed_total", "counter", "DB calls shed with 503 after queueing too long, by lane.");
+    for (int l = 0; l < 2; ++l) metrics.Sample("kv_db_shed_total", lane_labels[l], lanes[l].shed);
+    metrics.Family("kv_db_wait_seconds", "histogram", "Time from asking for a DB connection to the query starting or the call being shed, by lane.");
+    for (int l = 0; l < 2; ++l) metrics.Histogram("kv_db_wait_seconds", lane_labels[l], _metrics.db_wait[l].Collect());
+    metrics.Family("kv_db_query_duration_seconds", "histogram", "Time the DB query took, by lane.");
+    for (int l = 0; l < 2; ++l) metrics.Histogram("kv_db_query_duration_seconds", lane_labels[l], _metrics.db_query[l].Collect());
+
+    metrics.Family("kv_db_pool_workers", "gauge", "Threads running DB queries.");
+    metrics.Sample("kv_db_pool_workers", "", static_cast<uint64_t>(_pool.Size()));
+    metrics.Family("kv_db_pool_queue_depth", "gauge", "Tasks waiting for a DB pool worker.");
+    metrics.Sample("kv_db_pool_queue_depth", "", static_cast<uint64_t>(_pool.QueueDepth()));
+
+    res.status = 200;
+    res.set_content(out.str(), "text/plain; version=0.0.4");
+}
+
+void KVServer::HandleHealth(const httplib::Request& /*req*/, httplib::Response& res)
+{
+    res.status = 200;
+    res.set_content("OK", "text/plain");
+}
+
+void KVServer::HandleReady(const httplib::Request& /*req*/, httplib::Response& res)
+{
+    // Load balancers should only route traffic here once the cache is warm
+    if (_ready) {
+        res.status = 200;
+        res.set_content("READY", "text/plain");
+    } else {
+        res.status = 503;
+        res.set_content("Warming up cache", "text/plain");
+    }
 }
 
 
 void KVServer::HandleGet(const httplib::Request& req, httplib::Response& res)
 {
     // Some sanity checks before everything else
-    std::string key_param = req.get_param_value("key");
-    // This is a bad request, the parameter is missing
-    if (key_param.empty()) {
-        res.status = 400 ; // Bad Request
-        res.set_content("Missing Key parameter", "text/plain") ;
-        return ;
-    }
+    long long int_key = 0;
+    if (!parse_key(req, res, int_key)) return ;
+    TracedRequest traced(_trace, TraceOp::Get, int_key, res);
 #ifdef DEBUG_MODE
-    std::cout << "Get : " << key_param << std::endl ;
+    std::cout << "Get : " << int_key << std::endl ;
 #endif
 
-    std::string value ;
-    
-    int int_key = 0;
-    try {
-        int_key = std::stoll(key_param);
-    } catch (const std::exception &e) {
-        res.status = 400;
-        res.set_content("Key must be an integer", "text/plain");
-        return;
+    // Hits are copied straight from the cache into the response body, with
+    // no intermediate string. A body without a Content-Type is sent by
+    // httplib as text/plain, so none is set here.
+
+    // The hottest keys are served from this CPU's replica, skipping the shard lock
+    _hot.Record(int_key);
+    if (_hot.Get(int_key, res.body)) {
+        _metrics.hot_key_hits.Add();
+        res.status = 200 ;
+        return ;
     }
 
-    if (_cache.Get(int_key, value)) {
+    CacheLookup cached = _cache.Lookup(int_key, res.body);
+    if (cached == CacheLookup::Hit) {
         // Cache Hit: Read the value from the cache and return immediately 
 #ifdef DEBUG_MODE
-        std::cout << "[CACHE HIT]" << " Value : " << value << std::endl ;
+        std::cout << "[CACHE HIT]" << " Value : " << res.body << std::endl ;
 #endif
         res.status = 200 ; // OK
-        res.set_content(value, "text/plain") ;
         return ; // Skip the database access and mutex lock
     }
+    if (cached == CacheLookup::Absent) {
+        // Negative cache hit: the DB recently said this key does not exist
+        res.status = 404 ;
+        res.set_content("Key not found", "text/plain") ;
+        return ;
+    }
 
     // Acquire DB connection
-#if 0
-    // Async DB read using thread pool
-    auto fut = _pool.submit([this, int_key]() -> std::optional<std::string> {
-            auto conn = _dbpool.acquire();
-            return db_select_value(conn.get(), _db_name, _table_name, int_key);
-            });
-
-    // Wait for DB result (can also return immediately with async response if needed)
-    auto opt = fut.get();
+    std::string value ;
+#if 1
+    // DB read through the read lane, so misses do not queue behind writes
+    // Blocks this HTTP worker until a pool worker has run the query
+    bool failed = false;
+    std::optional<std::string> opt;
+    try {
+        opt = run_db(DBLane::Read, [this, int_key, &failed]() -> std::optional<std::string> {
+                return _store->Select(int_key, &failed);
+                });
+    } catch (const DBOverloaded &e) {
+        respond_overloaded(res, e);
+        return;
+    }
     if (!opt.has_value()) {
+        if (!failed) _cache.PutAbsent(int_key, _options.negative_ttl_sec);
         res.status = 404; res.set_content("Key not found", "text/plain");
         return;
     }
 
     value = opt.value();
-    _cache.Put(int_key, value);
+    _cache.Put(int_key, value, _options.cache_ttl_sec);
     res.status = 200; res.set_content(value, "text/plain");
 #else
-    auto conn = _dbpool.acquire();
-    if (!conn) {
-        res.status = 503;
-        res.set_content("No DB connection available", "text/plain");
-        return;
-    }
-
-    auto opt = db_select_value(conn.get(), _db_name, _table_name, int_key);
+    bool failed = false;
+    auto opt = _store->Select(int_key, &failed);
     if (!opt.has_value()) {
+        if (!failed) _cache.PutAbsent(int_key, _options.negative_ttl_sec);
         res.status = 404;
         res.set_content("Key not found", "text/plain");
         return;
@@ -146,7 +560,7 @@ void KVServer::HandleGet(const httplib::Request& req, httplib::Response& res)
 
     value = opt.value();
     // update cache
-    _cache.Put(int_key, value);
+    _cache.Put(int_key, value, _options.cache_ttl_sec);
 
     res.status = 200;
     res.set_content(value, "text/plain");
@@ -155,37 +569,50 @@ void KVServer::HandleGet(const httplib::Request& req, httplib::Response& res)
 
 void KVServer::HandlePut(const httplib::Request& req, httplib::Response& res)
 {
-    std::string key_param = req.get_param_value("key");
-    std::string value_param = req.get_param_value("value");
-#ifdef DEBUG_MODE
-    std::cout << "Put: " << key_param << " " << value_param << " " << std::endl ;
-#endif
+    // The value is the request body; the "value" query parameter is still
+    // accepted from older clients. Only the latter is copied.
+    std::string query_value;
+    if (req.body.empty()) query_value = req.get_param_value("value");
+    const std::string &value_param = req.body.empty() ? query_value : req.body;
 
     // Some sanity checks before everything else
-    if (key_param.empty() || value_param.empty()) {
+    long long int_key = 0;
+    if (!parse_key(req, res, int_key)) return ;
+    if (value_param.empty()) {
         res.status = 400 ; // Bad Request
         res.set_content("Missing Key/Value parameter", "text/plain") ;
         return ;
     }
+    TracedRequest traced(_trace, TraceOp::Put, int_key, res, value_param.size());
+#ifdef DEBUG_MODE
+    std::cout << "Put: " << int_key << " " << value_param << " " << std::endl ;
+#endif
 
-    int int_key = 0;
-    try {
-        int_key = std::stoll(key_param);
-    } catch (const std::exception &e) {
-        res.status = 400;
-        res.set_content("Key must be an integer", "text/plain");
-        return;
+    // Optional per-entry time-to-live in seconds for the cached copy
+    uint32_t ttl_sec = _options.cache_ttl_sec;
+    if (req.has_param("ttl")) {
+        try {
+            long long ttl = std::stoll(req.get_param_value("ttl"));
+            if (ttl < 0 || ttl > UINT32_MAX / 2) throw std::out_of_range("ttl");
+            ttl_sec = static_cast<uint32_t>(ttl);
+        } catch (const std::exception &e) {
+            res.status = 400;
+            res.set_content("TTL must be a non-negative integer", "text/plain");
+            return;
+        }
     }
 
     // Acquire DB connection
 #if 1
-    auto fut = _pool.submit([this, int_key, value_param]() -> bool {
-            auto conn = _dbpool.acquire();
-            return db_upsert(conn.get(), _db_name, _table_name, int_key, value_param);
-            });
-
     bool ok = false;
-    try { ok = fut.get(); } catch (...) { ok = false; }
+    try {
+        ok = run_db(DBLane::Write, [this, int_key, &value_param]() -> bool {
+                return _store->Upsert(int_key, value_param);
+                });
+    } catch (const DBOverloaded &e) {
+        respond_overloaded(res, e);
+        return;
+    } catch (...) { ok = false; }
 
     if (!ok) {
         res.status = 500;
@@ -193,28 +620,22 @@ void KVServer::HandlePut(const httplib::Request& req, httplib::Response& res)
         return;
     }
 
-    _cache.Put(int_key, value_param);
+    _cache.Put(int_key, value_param, ttl_sec);
+    _hot.Invalidate(int_key);
     res.status = 200;
     res.set_content("Key-value pair stored successfully", "text/plain");
 
 #else
-    auto conn = _dbpool.acquire();
-    if (!conn) {
-        res.status = 503;
-        res.set_content("No DB connection available", "text/plain");
-        return;
-    }
-
-    bool ok = db_upsert(conn.get(), _db_name, _table_name, int_key, value_param);
+    bool ok = _store->Upsert(int_key, value_param);
     if (!ok) {
         res.status = 503;
-        std::string err = mysql_error(conn.get());
-        res.set_content(std::string("Database write failed: ") + err, "text/plain");
+        res.set_content("Database write failed", "text/plain");
         return;
     }
 
     // Update cache
-    _cache.Put(int_key, value_param);
+    _cache.Put(int_key, value_param, ttl_sec);
+    _hot.Invalidate(int_key);
 
     res.status = 200;
     res.set_content("Key-value pair stored successfully", "text/plain");
@@ -223,32 +644,33 @@ void KVServer::HandlePut(const httplib::Request& req, httplib::Response& res)
 
 void KVServer::HandleDelete(const httplib::Request &req, httplib::Response &res)
 {
-    std::string key_param = req.get_param_value("key");
     // Some sanity checks before everything else
-    if (key_param.empty()) {
-        res.status = 400 ;
-        res.set_content("Missing Key parameter", "text/plain") ;
-        return ;
-    }
     long long int_key = 0;
-    try { int_key = std::stoll(key_param); }
-    catch (...) {
-        res.status = 400;
-        res.set_content("Key must be integer", "text/plain");
+    if (!parse_key(req, res, int_key)) return ;
+    TracedRequest traced(_trace, TraceOp::Delete, int_key, res);
+
+    // A recent lookup or delete already established that the key is gone.
+    // The probe is not a read (no recency bump, no hit counted, no copy);
+    // the handle it returns tells later whether a PUT replaced the entry.
+    SharedValue seen_value;
+    CacheLookup seen = _cache.Peek(int_key, &seen_value);
+    if (seen == CacheLookup::Absent) {
+        res.status = 404;
+        res.set_content("Key not found in database", "text/plain");
         return;
     }
 #if 1
-    auto fut = _pool.submit([this, int_key]() -> std::pair<bool,uint64_t> {
-            auto conn = _dbpool.acquire();
-            return db_delete(conn.get(), _db_name, _table_name, int_key);
-            });
-
     bool ok = false;
     uint64_t affected = 0;
     try {
-        auto res_pair = fut.get();
+        auto res_pair = run_db(DBLane::Write, [this, int_key]() -> std::pair<bool,uint64_t> {
+                return _store->Delete(int_key);
+                });
         ok = res_pair.first;
         affected = res_pair.second;
+    } catch (const DBOverloaded &e) {
+        respond_overloaded(res, e);
+        return;
     } catch (...) { ok = false; }
 
     if (!ok) {
@@ -257,8 +679,11 @@ void KVServer::HandleDelete(const httplib::Request &req, httplib::Response &res)
         return;
     }
 
+    // Either way the key is now absent from the DB, unless a PUT landed
+    // after the delete; that PUT's cache entry must not be hidden
+    _cache.ReplaceWithAbsent(int_key, _options.negative_ttl_sec, seen, seen_value);
+    _hot.Invalidate(int_key);
     if (affected > 0) {
-        _cache.Erase(int_key);
         res.status = 200;
         res.set_content("Key deleted successfully", "text/plain");
     } else {
@@ -267,23 +692,16 @@ void KVServer::HandleDelete(const httplib::Request &req, httplib::Response &res)
     }
 
 #else 
-    auto conn = _dbpool.acquire();
-    if (!conn) {
-        res.status = 503;
-        res.set_content("No DB connection available", "text/plain");
-        return;
-    }
-
-    auto [ok, affected] = db_delete(conn.get(), _db_name, _table_name, int_key);
+    auto [ok, affected] = _store->Delete(int_key);
     if (!ok) {
         res.status = 503;
-        std::string err = mysql_error(conn.get());
-        res.set_content(std::string("Database delete failed: ") + err, "text/plain");
+        res.set_content("Database delete failed", "text/plain");
         return;
     }
 
     if (affected > 0) {
         _cache.Erase(int_key);
+        _hot.Invalidate(int_key);
         res.status = 200;
         res.set_content("Key deleted successfully", "text/plain");
     } else {
@@ -296,65 +714,67 @@ void KVServer::HandleDelete(const httplib::Request &req, httplib::Response &res)
 void KVServer::HandleGetPopular(const httplib::Request& req, httplib::Response& res)
 {
     // Some sanity checks before everything else
-    std::string key_param = req.get_param_value("key");
-    // This is a bad request, the parameter is missing
-    if (key_param.empty()) {
-        res.status = 400 ; // Bad Request
-        res.set_content("Missing Key parameter", "text/plain") ;
-        return ;
-    }
+    long long int_key = 0;
+    if (!parse_key(req, res, int_key)) return ;
+    TracedRequest traced(_trace, TraceOp::GetPopular, int_key, res);
 #ifdef DEBUG_MODE
-    std::cout << "Get : " << key_param << std::endl ;
+    std::cout << "Get : " << int_key << std::endl ;
 #endif
 
-    std::string value ;
-    
-    int int_key = 0;
-    try {
-        int_key = std::stoll(key_param);
-    } catch (const std::exception &e) {
-        res.status = 400;
-        res.set_content("Key must be an integer", "text/plain");
-        return;
+    // Hits are copied straight from the cache into the response body, with
+    // no intermediate string. A body without a Content-Type is sent by
+    // httplib as text/plain, so none is set here.
+
+    // The hottest keys are served from this CPU's replica, skipping the shard lock
+    _hot.Record(int_key);
+    if (_hot.Get(int_key, res.body)) {
+        _metrics.hot_key_hits.Add();
+        res.status = 200 ;
+        return ;
     }
 
-    if (_cache.Get(int_key, value)) {
+    CacheLookup cached = _cache.Lookup(int_key, res.body);
+    if (cached == CacheLookup::Hit) {
         // Cache Hit: Read the value from the cache and return immediately 
 #ifdef DEBUG_MODE
-        std::cout << "[CACHE HIT]" << " Value : " << value << std::endl ;
+        std::cout << "[CACHE HIT]" << " Value : " << res.body << std::endl ;
 #endif
         res.status = 200 ; // OK
-        res.set_content(value, "text/plain") ;
         return ; // Skip the database access and mutex lock
     }
+    if (cached == CacheLookup::Absent) {
+        // Negative cache hit: the DB recently said this key does not exist
+        res.status = 404 ;
+        res.set_content("Key not found", "text/plain") ;
+        return ;
+    }
 
     // Acquire DB connection
+    std::string value ;
 #if 1
     // Async DB read using thread pool
-    auto fut = _pool.submit([this, int_key]() -> std::optional<std::string> {
-            auto conn = _dbpool.acquire();
-            return db_select_value(conn.get(), _db_name, _table_name, int_key);
-            });
-
-    // Wait for DB result (can also return immediately with async response if needed)
-    auto opt = fut.get();
+    bool failed = false;
+    // Blocks this HTTP worker until a pool worker has run the query
+    std::optional<std::string> opt;
+    try {
+        opt = run_db(DBLane::Read, [this, int_key, &failed]() -> std::optional<std::string> {
+                return _store->Select(int_key, &failed);
+                });
+    } catch (const DBOverloaded &e) {
+        respond_overloaded(res, e);
+        return;
+    }
     if (!opt.has_value()) {
+        if (!failed) _cache.PutAbsent(int_key, _options.negative_ttl_sec);
         res.status = 404; res.set_content("Key not found", "text/plain");
         return;
     }
 
     value = opt.value();
-    _cache.Put(int_key, value);
+    _cache.Put(int_key, value, _options.cache_ttl_sec);
     res.status = 200; res.set_content(value, "text/plain");
 #else
-    auto conn = _dbpool.acquire();
-    if (!conn) {
-        res.status = 503;
-        res.set_content("No DB connection available", "text/plain");
-        return;
-    }
-
-    auto opt = db_select_value(conn.get(), _db_name, _table_name, int_key);
+    auto opt = _store->Select(int_key);
     if (!opt.has_value()) {
         res.status = 404;
         res.set_content("Key not found", "text/plain");
@@ -363,13 +783,77 @@ void KVServer::HandleGetPopular(const httplib::Request& req, httplib::Response&
 
     value = opt.value();
     // update cache
-    _cache.Put(int_key, value);
+    _cache.Put(int_key, value, _options.cache_ttl_sec);
 
     res.status = 200;
     res.set_content(value, "text/plain");
 #endif
 }
 
+void KVServer::HandleScan(const httplib::Request& req, httplib::Response& res)
+{
+    // Some sanity checks before everything else
+    long long int_key = 0;
+    if (!parse_key(req, res, int_key)) return ;
+    long long count = DEFAULT_SCAN_COUNT;
+    switch (parse_integer_param(req, "count", count)) {
+    case ParamParse::Missing:
+        count = DEFAULT_SCAN_COUNT;
+        break;
+    case ParamParse::Invalid:
+        count = 0;
+        break;
+    case ParamParse::Ok:
+        break;
+    }
+    if (count < 1 || count > MAX_SCAN_COUNT) {
+        res.status = 400;
+        res.set_content("Count must be an integer between 1 and " + std::to_string(MAX_SCAN_COUNT), "text/plain");
+        return;
+    }
+    TracedRequest traced(_trace, TraceOp::Scan, int_key, res, static_cast<size_t>(count));
+#ifdef DEBUG_MODE
+    std::cout << "Scan : " << int_key << " " << count << std::endl ;
+#endif
+
+    // The cache has no key order, so every scan is a DB range read. Scanned
+    // rows are not cached: one long scan would evict the hot set.
+    bool ok = false;
+    std::vector<std::pair<long long, std::string>> rows;
+    try {
+        ok = run_db(DBLane::Read, [this, int_key, count, &rows]() -> bool {
+                return _store->SelectRange(int_key, static_cast<size_t>(count), rows);
+                });
+    } catch (const DBOverloaded &e) {
+        respond_overloaded(res, e);
+        return;
+    }
+    if (!ok) {
+        res.status = 500;
+        res.set_content("Database read failed", "text/plain");
+        return;
+    }
+    // Every store must return integer key order, as the mock store does
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i].first < int_key || (i > 0 && rows[i].first <= rows[i - 1].first)) {
+            res.status = 500;
+            res.set_content("Database returned rows out of key order", "text/plain");
+            return;
+        }
+    }
+
+    // One "<key>\t<value>\n" line per row, in key order
+    std::string body;
+    for (auto &row : rows) {
+        body += std::to_string(row.first);
+        body += '\t';
+        body += row.second;
+        body += '\n';
+    }
+    res.status = 200;
+    res.set_content(std::move(body), "text/plain");
+}
+
 // --------------------------- Utility helpers ---------------------------
 std::string esc_string(MYSQL* conn, const std::string &s) 
 {
@@ -383,8 +867,9 @@ std::string esc_string(MYSQL* conn, const std::string &s)
 
 // ----------------------------------------------------------------------------
 
-std::optional<std::string> db_select_value(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long key) 
+std::optional<std::string> db_select_value(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long key, bool *failed) 
 {
+    if (failed) *failed = true;
     if (!conn) return std::nullopt;
     // Build query: SELECT value FROM db.table WHERE k = <key> LIMIT 1
     std::string q = "SELECT value FROM " + db_name + "." + table_name + " WHERE k = " + std::to_string(key) + " LIMIT 1";
@@ -394,6 +879,7 @@ std::optional<std::string> db_select_value(MYSQL* conn, const std::string &db_na
     }
     MYSQL_RES* res = mysql_store_result(conn);
     if (!res) return std::nullopt;
+    if (failed) *failed = false;
     MYSQL_ROW row = mysql_fetch_row(res);
     std::optional<std::string> ret = std::nullopt;
     if (row) {
@@ -420,6 +906,68 @@ bool db_upsert(MYSQL* conn, const std::string &db_name, const std::string &table
     return true;
 }
 
+bool db_select_recent(MYSQL* conn, const std::string &db_name, const std::string &table_name, size_t limit, size_t offset, std::vector<std::pair<long long, std::string>> &rows)
+{
+    if (!conn) return false;
+    // Most recently written first; fall back to key order on tables without updated_at
+    std::string range = " LIMIT " + std::to_string(limit) + " OFFSET " + std::to_string(offset);
+    std::string q = "SELECT k, value FROM " + db_name + "." + table_name + " ORDER BY updated_at DESC" + range;
+    if (mysql_query(conn, q.c_str())) {
+        q = "SELECT k, value FROM " + db_name + "." + table_name + " ORDER BY k" + range;
+        if (mysql_query(conn, q.c_str())) return false;
+    }
+    MYSQL_RES* res = mysql_store_result(conn);
+    if (!res) return false;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res))) {
+        unsigned long *lengths = mysql_fetch_lengths(res);
+        if (!row[0] || !lengths) continue;
+        char *end = nullptr;
+        long long key = std::strtoll(row[0], &end, 10);
+        if (end == row[0]) continue; // not an integer key, the cache cannot hold it
+        rows.emplace_back(key, std::string(row[1] ? row[1] : "", lengths[1]));
+    }
+    mysql_free_result(res);
+    return true;
+}
+
+bool db_select_range(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long start_key, size_t limit, std::vector<std::pair<long long, std::string>> &rows)
+{
+    if (!conn) return false;
+    // Build query: SELECT k, value FROM db.table WHERE k >= <key> ORDER BY k LIMIT <limit>
+    std::string q = "SELECT k, value FROM " + db_name + "." + table_name + " WHERE k >= " + std::to_string(start_key) +
+                    " ORDER BY k LIMIT " + std::to_string(limit);
+    if (mysql_query(conn, q.c_str())) return false;
+    MYSQL_RES* res = mysql_store_result(conn);
+    if (!res) return false;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res))) {
+        unsigned long *lengths = mysql_fetch_lengths(res);
+        if (!row[0] || !lengths) continue;
+        rows.emplace_back(std::strtoll(row[0], nullptr, 10), std::string(row[1] ? row[1] : "", lengths[1]));
+    }
+    mysql_free_result(res);
+    return true;
+}
+
+// 1 when the key column has an integer type, 0 when not, -1 when the query failed
+int db_key_is_integer(MYSQL* conn, const std::string &db_name, const std::string &table_name)
+{
+    if (!conn) return -1;
+    std::string q = "SELECT DATA_TYPE FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = '" + esc_string(conn, db_name) +
+                    "' AND TABLE_NAME = '" + esc_string(conn, table_name) + "' AND COLUMN_NAME = 'k'";
+    if (mysql_query(conn, q.c_str())) return -1;
+    MYSQL_RES* res = mysql_store_result(conn);
+    if (!res) return -1;
+    MYSQL_ROW row = mysql_fetch_row(res);
+    std::string type = row && row[0] ? row[0] : "";
+    mysql_free_result(res);
+    if (type.empty()) return -1;
+    // tinyint, smallint, mediumint, int, bigint
+    for (auto &c : type) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return type.size() >= 3 && type.compare(type.size() - 3, 3, "int") == 0 ? 1 : 0;
+}
+
 std::pair<bool, uint64_t> db_delete(MYSQL* conn, const std::string &db_name, const std::string &table_name, long long key)
 {
     if (!conn) return {false, 0};
@@ -431,20 +979,186 @@ std::pair<bool, uint64_t> db_delete(MYSQL* conn, const std::string &db_name, con
     return {true, static_cast<uint64_t>(affected)};
 }
 
+// --------------------------- MySQLStore ---------------------------
+
+std::optional<std::string> MySQLStore::Select(long long key, bool *failed)
+{
+    auto conn = _dbpool.acquire();
+    return db_select_value(conn.get(), _db_name, _table_name, key, failed);
+}
+
+bool MySQLStore::Upsert(long long key, const std::string &value)
+{
+    auto conn = _dbpool.acquire();
+    return db_upsert(conn.get(), _db_name, _table_name, key, value);
+}
+
+std::pair<bool, uint64_t> MySQLStore::Delete(long long key)
+{
+    auto conn = _dbpool.acquire();
+    return db_delete(conn.get(), _db_name, _table_name, key);
+}
+
+bool MySQLStore::SelectRecent(size_t limit, size_t offset, std::vector<std::pair<long long, std::string>> &rows)
+{
+    auto conn = _dbpool.acquire();
+    if (db_select_recent(conn.get(), _db_name, _table_name, limit, offset, rows)) return true;
+    std::cerr << "MySQL: " << mysql_error(conn.get()) << std::endl;
+    return false;
+}
+
+bool MySQLStore::SelectRange(long long start_key, size_t limit, std::vector<std::pair<long long, std::string>> &rows)
+{
+    auto conn = _dbpool.acquire();
+    // A string key column compares "WHERE k >= 42" as numbers but sorts as
+    // strings, so the rows would come back out of key order
+    if (_integer_keys == 0) {
+        int integer = db_key_is_integer(conn.get(), _db_name, _table_name);
+        if (integer < 0) {
+            std::cerr << "MySQL: " << mysql_error(conn.get()) << std::endl;
+            return false;
+        }
+        _integer_keys = integer ? 1 : -1;
+        if (!integer)
+            std::cerr << "Scans disabled: key column of " << _db_name << "." << _table_name
+                      << " is not an integer (see scripts/create_kvstore.sql)" << std::endl;
+    }
+    if (_integer_keys < 0) return false;
+    return db_select_range(conn.get(), _db_name, _table_name, start_key, limit, rows);
+}
+
 void KVServer::Run(int port) 
 {
     // Runnnn Forrresst Runnnn
     setup_routes() ;
-    std::cout << "Listening on 0.0.0.0:" << port << std::endl;
+    load_snapshot() ;
+    start_maintenance() ;
+    // The port opens (liveness) while the warm-up runs; /readyz flips once it is done
+    _warmup_thread = std::thread(&KVServer::warmup_from_db, this) ;
+    if (!_options.trace_path.empty()) {
+        if (_trace.Start(_options.trace_path))
+            std::cout << "Recording request trace to " << _options.trace_path << std::endl;
+        else
+            std::cerr << "Cannot write request trace " << _options.trace_path << ", tracing disabled" << std::endl;
+    }
 
-    if (!_http_server.listen("0.0.0.0", port)) {
-        std::cerr << "Failed to bind to port " << port << std::endl;
+    // A signal may have arrived during the (possibly long) snapshot load
+    if (!_stop_requested) {
+        if (!_http_server.bind_to_port("0.0.0.0", port)) {
+            std::cerr << "Failed to bind to port " << port << std::endl;
+        } else if (!_stop_requested) {
+            std::cout << "Listening on 0.0.0.0:" << port << std::endl;
+            _http_server.listen_after_bind();
+        }
     }
+
+    // listen() returns once Stop() is called: persist the warm cache
+    if (_warmup_thread.joinable()) _warmup_thread.join() ;
+    stop_maintenance() ;
+    save_snapshot() ;
+    if (_trace.Enabled()) {
+        _trace.Stop() ;
+        std::cout << "Request trace: " << _trace.Written() << " records written, " << _trace.Dropped()
+                  << " dropped (writer behind)" << std::endl;
+    }
+}
+
+static std::string env_or(const char *name, const std::string &fallback)
+{
+    const char *value = getenv(name);
+    return (value && *value) ? std::string(value) : fallback;
+}
+
+// "rate:burst" (or just "rate", burst = rate) -> RateLimit
+static RateLimit parse_rate_limit(const std::string &spec)
+{
+    RateLimit limit;
+    size_t colon = spec.find(':');
+    limit.rate = std::stod(spec.substr(0, colon));
+    double burst = colon == std::string::npos ? limit.rate : std::stod(spec.substr(colon + 1));
+    limit.burst = static_cast<uint32_t>(std::max(1.0, burst));
+    return limit;
+}
+
+// "client=rate:burst,client=rate:burst,..." -> per-client overrides
+static std::unordered_map<std::string, RateLimit> parse_rate_limit_overrides(const std::string &spec)
+{
+    std::unordered_map<std::string, RateLimit> overrides;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos || eq == 0) continue;
+        overrides[item.substr(0, eq)] = parse_rate_limit(item.substr(eq + 1));
+    }
+    return overrides;
 }
 
 int main() 
 {
-    KVServer server(getenv("DB_USER"), getenv("DB_PASS"), getenv("DB_HOST"), getenv("DB_NAME"), 8);
+    KVServerOptions options;
+    options.snapshot_path = env_or("KV_SNAPSHOT_PATH", "");
+    options.snapshot_interval_sec = std::stoul(env_or("KV_SNAPSHOT_INTERVAL_SEC", "0"));
+    options.cache_ttl_sec = std::stoul(env_or("KV_CACHE_TTL_SEC", "0"));
+    options.negative_ttl_sec = std::stoul(env_or("KV_NEGATIVE_TTL_SEC", "2"));
+    options.cache_shards = std::stoul(env_or("KV_CACHE_SHARDS", "0"));
+    options.hot_keys = std::stoul(env_or("KV_HOT_KEYS", "64"));
+    options.hot_sample_every = std::stoul(env_or("KV_HOT_SAMPLE", "16"));
+    options.numa_aware = env_or("KV_NUMA", "0") == "1";
+    options.warmup_keys = std::stoul(env_or("KV_WARMUP_KEYS", "0"));
+    options.warmup_connections = std::stoul(env_or("KV_WARMUP_CONNECTIONS", "4"));
+    options.db_lanes.read_reserved = std::stoul(env_or("KV_DB_READ_RESERVED", "2"));
+    options.db_lanes.write_reserved = std::stoul(env_or("KV_DB_WRITE_RESERVED", "1"));
+    options.db_lanes.read_weight = std::stoul(env_or("KV_DB_READ_WEIGHT", "3"));
+    options.db_lanes.write_weight = std::stoul(env_or("KV_DB_WRITE_WEIGHT", "1"));
+    options.db_lanes.queue_target_ms = std::stoul(env_or("KV_DB_QUEUE_TARGET_MS", "20"));
+    options.db_lanes.queue_interval_ms = std::stoul(env_or("KV_DB_QUEUE_INTERVAL_MS", "100"));
+    options.db_lanes.queue_deadline_ms = std::stoul(env_or("KV_DB_QUEUE_DEADLINE_MS", "1000"));
+    // By default half the HTTP workers may wait for the DB; the rest keep serving cache hits
+    options.db_lanes.max_waiting = std::stoul(env_or("KV_DB_MAX_WAITING", std::to_string(CPPHTTPLIB_THREAD_POOL_COUNT / 2)));
+    options.rate_limit.default_limit = parse_rate_limit(env_or("KV_RATE_LIMIT", "0"));
+    options.rate_limit.overrides = parse_rate_limit_overrides(env_or("KV_RATE_LIMIT_OVERRIDES", ""));
+    options.rate_limit.max_clients = std::stoul(env_or("KV_RATE_LIMIT_CLIENTS", "4096"));
+    options.rate_limit_header = env_or("KV_RATE_LIMIT_HEADER", "");
+    options.trace_path = env_or("KV_TRACE_PATH", "");
+
+    // Handle SIGINT/SIGTERM on a dedicated thread so that the server can shut
+    // down cleanly (and write its cache snapshot) when run.sh kills it.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    // KV_STORE=mock serves from memory instead of MySQL, for benchmarks without a database
+    const size_t pool_size = 8;
+    std::unique_ptr<KVStore> store;
+    std::string store_kind = env_or("KV_STORE", "mysql");
+    if (store_kind == "mock") {
+        MockStoreOptions mock;
+        mock.latency_us = std::stoul(env_or("KV_MOCK_LATENCY_US", "0"));
+        mock.slots = std::stoul(env_or("KV_MOCK_SLOTS", std::to_string(pool_size)));
+        mock.keys = std::stoul(env_or("KV_MOCK_KEYS", "0"));
+        mock.value_size = std::stoul(env_or("KV_MOCK_VALUE_SIZE", "32"));
+        store = std::make_unique<MockKVStore>(mock);
+    } else if (store_kind == "mysql") {
+        store = std::make_unique<MySQLStore>(env_or("DB_HOST", ""), PORT, env_or("DB_USER", ""), env_or("DB_PASS", ""),
+                                             env_or("DB_NAME", ""), "kv", pool_size);
+    } else {
+        std::cerr << "Unknown KV_STORE " << store_kind << " (expected mysql or mock)" << std::endl;
+        return 1;
+    }
+
+    KVServer server(std::move(store), pool_size, 10000, options);
+
+    std::thread([&server, signals]() {
+        int sig = 0;
+        sigwait(&signals, &sig);
+        std::cout << "Caught signal " << sig << ", shutting down." << std::endl;
+        server.Stop();
+    }).detach();
+
+    server.Run(PORT);
     return 0;
 }
 
@@ -3,66 +3,24 @@
 #include <shared_mutex>
 #include <httplib.h>
 #include <LRUCache.h>
+#include <HotKeyCache.h>
+#include <Numa.h>
+#include <ThreadPool.h>
+#include <DBScheduler.h>
+#include <RateLimiter.h>
+#include <RequestParse.h>
+#include <RequestTrace.h>
+#include <KVStore.h>
+#include <Metrics.h>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
 #include <cassert>
 #include <future>
+#include <thread>
+#include <atomic>
 #include <mysql/mysql.h>
 
-class ThreadPool {
-public:
-    ThreadPool(size_t n) : stop_flag(false) {
-        if (n == 0) n = 1;
-        for (size_t i = 0; i < n; ++i) {
-            workers.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(mtx);
-                        cv.wait(lock, [this] { return stop_flag || !tasks.empty(); });
-                        if (stop_flag && tasks.empty()) return;
-                        task = std::move(tasks.front());
-                        tasks.pop();
-                    }
-                    try { task(); } catch (...) { /* ignore task exceptions */ }
-                }
-            });
-        }
-    }
-
-    ~ThreadPool() {
-        {
-            std::unique_lock<std::mutex> lock(mtx);
-            stop_flag = true;
-        }
-        cv.notify_all();
-        for (auto &t : workers) if (t.joinable()) t.join();
-    }
-
-    // Submit a task and get a future
-    template<typename F>
-    auto submit(F&& f) -> std::future<decltype(f())> {
-        using R = decltype(f());
-        auto task_ptr = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
-        std::future<R> fut = task_ptr->get_future();
-        {
-            std::unique_lock<std::mutex> lock(mtx);
-            if (stop_flag) throw std::runtime_error("ThreadPool stopped");
-            tasks.emplace([task_ptr](){ (*task_ptr)(); });
-        }
-        cv.notify_one();
-        return fut;
-    }
-
-private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex mtx;
-    std::condition_variable cv;
-    bool stop_flag;
-};
-
 class DBPool {
 public:
     DBPool(const std::string &host, unsigned int port,
@@ -129,32 +87,209 @@ private:
     std::condition_variable _cv;
 };
 
+// The MySQL table behind the cache: each query borrows a pooled connection
+class MySQLStore : public KVStore {
+public:
+    MySQLStore(const std::string &host, unsigned int port, const std::string &user, const std::string &pass,
+               const std::string &db_name, const std::string &table_name, size_t pool_size)
+        : _dbpool(host, port, user, pass, db_name, pool_size), _db_name(db_name), _table_name(table_name) {}
+
+    std::optional<std::string> Select(long long key, bool *failed = nullptr) override;
+    bool Upsert(long long key, const std::string &value) override;
+    std::pair<bool, uint64_t> Delete(long long key) override;
+    bool SelectRecent(size_t limit, size_t offset, std::vector<std::pair<long long, std::string>> &rows) override;
+    bool SelectRange(long long start_key, size_t limit, std::vector<std::pair<long long, std::string>> &rows) override;
+    std::string Describe() const override { return "MySQL table " + _db_name + "." + _table_name; }
+
+private:
+    DBPool _dbpool;
+    std::string _db_name;
+    std::string _table_name;
+    std::atomic<int> _integer_keys{0};      // key column is an integer: 1 yes, -1 no, 0 not checked yet
+};
+
+// httplib's default task queue, except that each connection is stamped with
+// the time it was queued, for the DB admission control (RequestQueueTime)
+class TimedTaskQueue : public httplib::TaskQueue {
+public:
+    explicit TimedTaskQueue(size_t threads) : _pool(threads) {}
+
+    bool enqueue(std::function<void()> fn) override {
+        return _pool.enqueue([queued = RequestQueueTime::Clock::now(), fn = std::move(fn)]() {
+            RequestQueueTime::Set(queued);
+            fn();
+            RequestQueueTime::Clear();
+        });
+    }
+
+    void shutdown() override { _pool.shutdown(); }
+
+private:
+    httplib::ThreadPool _pool;
+};
+
+// httplib task queue for NUMA-aware mode: one worker pool per node, each
+// worker pinned to its node's CPUs, with new connections spread round-robin
+// over the nodes. Requests then allocate and touch memory on their own node.
+// Connections are stamped like in TimedTaskQueue.
+class NumaTaskQueue : public httplib::TaskQueue {
+public:
+    explicit NumaTaskQueue(size_t total_threads) {
+        const NumaTopology &topology = NumaTopology::Get();
+        size_t per_node = std::max<size_t>(1, total_threads / topology.Nodes());
+        for (int node = 0; node < topology.Nodes(); ++node)
+            _pools.push_back(std::make_unique<httplib::ThreadPool>(per_node));
+    }
+
+    bool enqueue(std::function<void()> fn) override {
+        int node = static_cast<int>(_next.fetch_add(1, std::memory_order_relaxed) % _pools.size());
+        return _pools[node]->enqueue([node, queued = RequestQueueTime::Clock::now(), fn = std::move(fn)]() {
+            // httplib creates the workers, so they pin themselves on first use
+            thread_local int pinned_node = -1;
+            if (pinned_node != node) {
+                NumaTopology::Get().PinThreadToNode(node);
+                pinned_node = node;
+            }
+            RequestQueueTime::Set(queued);
+            fn();
+            RequestQueueTime::Clear();
+        });
+    }
+
+    void shutdown() override {
+        for (auto &pool : _pools) pool->shutdown();
+    }
+
+private:
+    std::vector<std::unique_ptr<httplib::ThreadPool>> _pools;
+    std::atomic<size_t> _next{0};
+};
+
+// Optional server tunables, filled in from the environment by main().
+struct KVServerOptions {
+    std::string snapshot_path ;             // Cache snapshot file, empty disables snapshots
+    unsigned    snapshot_interval_sec = 0 ; // Periodic snapshot interval, 0 = only on shutdown
+    size_t      warmup_keys = 0 ;           // Keys to stream from the DB into the cache at startup, 0 = none
+    size_t      warmup_connections = 4 ;    // DB connections used in parallel by the warm-up
+    size_t      cache_shards = 0 ;          // Cache shard count (rounded to a power of two), 0 = 4x hardware threads, fewer if shards would hold < 1024 entries
+    uint32_t    cache_ttl_sec = 0 ;         // Default TTL of cached entries, 0 = until evicted
+    uint32_t    negative_ttl_sec = 2 ;      // How long a "key not found" is remembered, 0 = never
+    size_t      hot_keys = 64 ;             // Keys replicated per CPU by the hot-key cache, 0 = off
+    uint32_t    hot_sample_every = 16 ;     // Count one in N reads towards key hotness
+    bool        numa_aware = false ;        // Place shards/hot replicas per NUMA node and pin HTTP workers
+    DBSchedulerOptions db_lanes ;           // Reserved connections and weights of the DB read/write lanes
+    RateLimiterOptions rate_limit ;         // Per-client request rate limits
+    std::string rate_limit_header ;         // Identify clients by this header (e.g. X-API-Key), empty = by IP
+    std::string trace_path ;                // Record every request to this binary trace file, empty = off
+};
+
+// Routes measured by /metrics, in the order of ROUTE_NAMES
+enum class Route { Get, Put, Delete, GetPopular, Scan, Stats, Metrics, Health, Ready, Count };
+
+// Request and DB timings for /metrics. The cache, the DB scheduler and the
+// thread pool keep their own counters, which are only read on a scrape.
+struct ServerMetrics {
+    static const size_t STATUS_CLASSES = 5 ;                       // 1xx .. 5xx
+    StripedHistogram request_latency[static_cast<size_t>(Route::Count)] ;
+    StripedCounter   responses[static_cast<size_t>(Route::Count)][STATUS_CLASSES] ;
+    StripedHistogram db_wait[2] ;          // per DBLane: until a pool worker runs the query, or the call is shed
+    StripedHistogram db_query[2] ;         // per DBLane: the query itself
+    StripedCounter   hot_key_hits ;        // reads answered by the hot-key replicas
+};
+
 class KVServer {
 public:
     // Constructor
-    KVServer(const std::string& user, const std::string& password, const std::string& host, const std::string &db_name, size_t pool_size, size_t cache_capacity = 10000, const std::string &table_name = "kv") ;
+    // `store` is queried by `pool_size` DB pool workers
+    KVServer(std::unique_ptr<KVStore> store, size_t pool_size, size_t cache_capacity = 10000, const KVServerOptions &options = KVServerOptions()) ;
     // Destructor
     ~KVServer() ;
+    // Blocks serving requests until Stop() is called
     void Run(int port);
+    // Makes Run() return; safe to call from another thread, also before
+    // Run() has started listening
+    void Stop();
 
 private:
     // API to set up the callback functions for the get/put routines
     void setup_routes();
 
+    // Rejects the request with 429 when its client is over its rate limit
+    bool admit_client(const httplib::Request& req, httplib::Response& res);
+
+    // Cache snapshot helpers
+    void load_snapshot();
+    void save_snapshot();
+
+    // Streams the most recently written keys from the DB into the cache,
+    // then marks the server ready
+    void warmup_from_db();
+
+    // Background thread for periodic housekeeping (expiry sweep, hot keys, snapshots)
+    void start_maintenance();
+    void stop_maintenance();
+    void maintenance_loop();
+
     // REST API Handlers
     void HandleGet(const httplib::Request& req, httplib::Response& res);
     void HandlePut(const httplib::Request& req, httplib::Response& res);
     void HandleDelete(const httplib::Request& req, httplib::Response& res);
     void HandleGetPopular(const httplib::Request& req, httplib::Response& res);
 
+    // Up to `count` key/value pairs with keys >= `key`, in key order (YCSB scans)
+    void HandleScan(const httplib::Request& req, httplib::Response& res);
+
+    // Per-shard cache counters, shard imbalance and DB lane counters
+    void HandleStats(const httplib::Request& req, httplib::Response& res);
+
+    // The same counters plus request and DB latency histograms, in the
+    // Prometheus text format
+    void HandleMetrics(const httplib::Request& req, httplib::Response& res);
+
+    // Liveness (process is up) and readiness (cache is warm) probes
+    void HandleHealth(const httplib::Request& req, httplib::Response& res);
+    void HandleReady(const httplib::Request& req, httplib::Response& res);
+
+    // _db.Run() that also records how long the call waited for a DB
+    // connection (or until it was shed) and how long the query itself took
+    template <typename F>
+    auto run_db(DBLane lane, F&& f) -> decltype(f()) {
+        size_t l = static_cast<size_t>(lane);
+        auto queued = std::chrono::steady_clock::now();
+        try {
+            return _db.Run(lane, [this, l, queued, &f]() -> decltype(f()) {
+                _metrics.db_wait[l].Observe(elapsed_us(queued));
+                ScopedLatency query(_metrics.db_query[l]);
+                return f();
+            });
+        } catch (const DBOverloaded &) {
+            // The longest waits end here under overload; leaving them out
+            // would make the histogram look healthiest when it matters most
+            _metrics.db_wait[l].Observe(elapsed_us(queued));
+            throw;
+        }
+    }
 
 
 
 private:
     httplib::Server _http_server;
     ThreadPool _pool;
-    DBPool _dbpool;
-    std::string _db_name;
-    std::string _table_name;
+    DBScheduler _db;            // every DB call from a handler goes through here
+    std::unique_ptr<KVStore> _store;
     ShardedLRUCache _cache;
+    HotKeyCache _hot;
+    KVServerOptions _options;
+    RateLimiter _limiter;
+    TraceRecorder _trace;
+    ServerMetrics _metrics;
+
+    std::thread _warmup_thread;
+    std::atomic<bool> _ready{false};
+    std::atomic<bool> _stop_requested{false};   // set by Stop(), checked by Run() around listen()
+
+    std::thread _maintenance_thread;
+    std::mutex _maintenance_mutex;
+    std::condition_variable _maintenance_cv;
+    bool _maintenance_stop = false;
 };